@@ -1,4 +1,7 @@
 #version 430
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
 
 layout(location = 0) out vec4 FragColor;
 
@@ -6,6 +9,16 @@ layout (location = 0) in vec3 aFragPos;
 layout (location = 1) in vec4 aColor;
 layout (location = 2) in vec3 aNormal;
 layout (location = 3) in vec2 aTexCoord;
+layout (location = 4) flat in int aTex;
+
+// instances pick their texture by index, so they all draw in one call (see TextureSet)
+#ifdef BINDLESS
+layout (std430, binding = 5) readonly buffer TextureHandles {
+	uvec2 textureHandles[];
+};
+#else
+layout (binding = 0) uniform sampler2DArray textures;
+#endif
 
 layout (binding = 0) uniform UniformBuffer {
 	mat4 projection;
@@ -17,10 +30,17 @@ layout (binding = 0) uniform UniformBuffer {
 	vec4 lightClr;
 	vec4 ambientClr;
 	float ambientStr;
+	float rot;
+	int faces;
 };
 
 void main() {
-	vec4 color = vec4(1.0f);
+	vec4 color = aColor;
+#ifdef BINDLESS
+	if (aTex >= 0) color *= texture(sampler2D(textureHandles[aTex]), aTexCoord);
+#else
+	if (aTex >= 0) color *= texture(textures, vec3(aTexCoord, aTex));
+#endif
 	vec3 ambient = ambientStr * ambientClr.xyz;
 
 	vec3 norm = normalize(aNormal);
@@ -1,4 +1,12 @@
 #version 430
+#ifdef DRAW_PARAMETERS
+#extension GL_ARB_shader_draw_parameters : require
+#define DRAW_ID gl_DrawIDARB
+#else
+// set by DrawList before each draw, which it then issues one at a time
+layout (location = 0) uniform int drawID;
+#define DRAW_ID drawID
+#endif
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec4 aColor;
@@ -9,6 +17,7 @@ layout (location = 0) out vec3 FragPos;
 layout (location = 1) out vec4 Color;
 layout (location = 2) out vec3 Normal;
 layout (location = 3) out vec2 TexCoord;
+layout (location = 4) flat out int Tex;
 
 layout (binding = 0) uniform UniformBuffer {
 	mat4 projection;
@@ -20,18 +29,103 @@ layout (binding = 0) uniform UniformBuffer {
 	vec4 lightClr;
 	vec4 ambientClr;
 	float ambientStr;
+	float rot;
+	int faces;
 };
 
+struct Instance {
+	vec4 offsetScale;
+	vec4 clr;
+	vec2 spin;
+	int tex; // index into the TextureSet, -1 for untextured
+};
+
+layout (std430, binding = 1) readonly buffer Instances {
+	Instance instances[];
+};
+
+// per draw of the multi-draw (see DrawList)
+struct Draw {
+	uint firstInstance;
+};
+
+layout (std430, binding = 6) readonly buffer Draws {
+	Draw draws[];
+};
+
+const float PI = 3.14159265358979323846f;
+const float RADIUS = 1.0f;
+const float HEIGHT = 1.0f;
+
+// rim point i of the prism in (x, z)
+vec2 rim(int i) {
+	float a = float(i) / float(faces) * 2.0f*PI;
+	return RADIUS * vec2(sin(a), cos(a));
+}
+
+// Rebuilds vertex `id` of the triangle soup genVerts would produce for `faces`: 6 vertices per side
+// face followed by the top and bottom cap fans.
+void prismVertex(int id, out vec3 pos, out vec3 normal) {
+	const float bot = -HEIGHT/2.0f;
+	const float top = HEIGHT/2.0f;
+	if (id < faces*6) { // side
+		const int right_corner[6] = int[](1, 0, 0, 0, 1, 1);
+		const int top_corner[6] = int[](1, 1, 0, 0, 0, 1);
+		int face = id / 6, corner = id % 6;
+		vec2 left = rim(face), right = rim(face + 1);
+		vec2 p = right_corner[corner] == 1 ? right : left;
+		pos = vec3(p.x, top_corner[corner] == 1 ? top : bot, p.y);
+		normal = normalize(cross(
+			vec3(left.x, top, left.y) - vec3(right.x, top, right.y),
+			vec3(left.x, bot, left.y) - vec3(left.x, top, left.y)
+		));
+		return;
+	}
+	int cap_id = id - faces*6;
+	int cap_len = (faces - 2)*3;
+	bool is_top = cap_id < cap_len;
+	int tri = (cap_id % cap_len) / 3 + 1, corner = cap_id % 3;
+	// top: (0, i, i+1), bot: (0, i+1, i)
+	int i = corner == 0 ? 0 : (is_top == (corner == 1) ? tri : tri + 1);
+	vec2 p = rim(i);
+	pos = vec3(p.x, is_top ? top : bot, p.y);
+	normal = vec3(0.0f, is_top ? 1.0f : -1.0f, 0.0f);
+}
+
+// Per face planar mapping, so every mesh source gets uvs without storing them: each side face shows
+// the whole texture, the caps a disc cut out of it. Textures are uploaded top row first (like DDS),
+// so v runs down the image.
+vec2 prismUV(vec3 pos, vec3 normal) {
+	if (abs(normal.y) > 0.5f) return vec2(pos.x / (2.0f*RADIUS) + 0.5f, 0.5f - pos.z / (2.0f*RADIUS));
+	vec2 n = normalize(normal.xz);
+	float along = dot(pos.xz, vec2(n.y, -n.x));
+	float half_edge = sqrt(max(RADIUS*RADIUS - dot(pos.xz, n)*dot(pos.xz, n), 1e-6f));
+	return vec2(along / (2.0f*half_edge) + 0.5f, 0.5f - pos.y / HEIGHT);
+}
+
 void main() {
-	vec4 fragPos = model * vec4(aPos, 1.0f);
-	vec4 pos = projection * view * fragPos;
-	vec4 color = aColor;
+	vec3 position = aPos;
 	vec3 normal = aNormal;
-	vec2 texCoord = aTexCoord;
+	if (faces > 0) prismVertex(gl_VertexID, position, normal);
+
+	Instance inst = instances[draws[DRAW_ID].firstInstance + gl_InstanceID];
+	float angle = radians(inst.spin.x + rot * inst.spin.y);
+	mat3 spin = mat3(
+		cos(angle), 0.0f, -sin(angle),
+		0.0f, 1.0f, 0.0f,
+		sin(angle), 0.0f, cos(angle)
+	);
+
+	vec4 fragPos = model * vec4(spin * position * inst.offsetScale.w + inst.offsetScale.xyz, 1.0f);
+	vec4 pos = projection * view * fragPos;
+	vec4 color = inst.clr;
+	vec2 texCoord = inst.tex >= 0 ? prismUV(position, normal) : aTexCoord;
+	normal = spin * normal;
 
 	gl_Position = pos;
 	FragPos = fragPos.xyz;
 	Color = color;
 	Normal = mat3(model_IT) * normal;
 	TexCoord = texCoord;
+	Tex = inst.tex;
 }
@@ -0,0 +1,7 @@
+#!/usr/bin/env bash
+# Offscreen draw throughput vs instance count, e.g. `./bench.sh --faces 32`
+
+for n in 1 10 100 1000 10000 100000; do
+	echo "instances: $n"
+	./main --headless --frames "${FRAMES:-300}" --instances "$n" "$@" | grep -E "median|p99|throughput"
+done
@@ -1,3 +1,23 @@
 #!/usr/bin/env bash
 
-g++ -o main -Og -Wall main.cpp ./glad/src/gl.c -I ./glad/include -l glfw -I . "$@"
+# EMBED_SHADERS=1 ./build.sh compiles the shader sources into the binary, so it runs from any
+# working directory without the shader files (no hot reload then)
+if [ -n "$EMBED_SHADERS" ]; then
+	{
+		echo "// generated by build.sh from the shader files, do not edit"
+		echo "#pragma once"
+		echo ""
+		echo "constexpr EmbeddedShader EMBEDDED_SHADERS[] = {"
+		for shader in 3d.vert 3d.frag prism.comp; do
+			printf '\t{ "%s", R"glsl(' "$shader"
+			cat "$shader"
+			printf ')glsl" },\n'
+		done
+		echo "};"
+	} > embedded_shaders.hpp
+	set -- -DEMBED_SHADERS "$@"
+fi
+
+g++ -o main -Og -Wall main.cpp ./glad/src/gl.c -I ./glad/include -l glfw -l EGL -pthread -I . "$@"
+# offline texture baker, see dds.hpp
+g++ -o texbake -Og -Wall texbake.cpp -I ./glad/include -pthread -I . "$@"
@@ -0,0 +1,152 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// DDS container for pre-mipped, pre-compressed textures (bake them with texbake). Just the file
+// format, no GL, so texbake builds without it: loadDDSToTexture2D (texturestream.hpp) maps a file
+// and hands each level straight to GL, and the texture streamer (and so --texture) takes them too.
+// Rows are stored top row first as the format specifies, same as the streamer uploads; 3d.vert flips v.
+constexpr uint DDS_MAGIC = 0x20534444; // "DDS "
+constexpr uint DDS_DXGI_FORMAT_BC7_UNORM = 98;
+
+constexpr uint ddsFourCC(const char code[5]) {
+	return (uint)code[0] | (uint)code[1] << 8 | (uint)code[2] << 16 | (uint)code[3] << 24;
+}
+
+struct DdsPixelFormat {
+	uint size;
+	uint flags;
+	uint four_cc;
+	uint rgb_bit_count;
+	uint r_mask;
+	uint g_mask;
+	uint b_mask;
+	uint a_mask;
+};
+
+struct DdsHeader {
+	uint magic;
+	uint size;
+	uint flags;
+	uint height;
+	uint width;
+	uint pitch_or_linear_size;
+	uint depth;
+	uint mip_map_count;
+	uint reserved1[11];
+	DdsPixelFormat pixel_format;
+	uint caps;
+	uint caps2;
+	uint caps3;
+	uint caps4;
+	uint reserved2;
+};
+
+// follows DdsHeader when pixel_format.four_cc is "DX10"
+struct DdsHeaderDx10 {
+	uint dxgi_format;
+	uint resource_dimension;
+	uint misc_flag;
+	uint array_size;
+	uint misc_flags2;
+};
+
+static_assert(sizeof(DdsHeader) == 128 && sizeof(DdsHeaderDx10) == 20, "DDS headers must match the file layout");
+
+// `pixels` holds all levels back to back, largest first, `level_offsets` has levels + 1 entries
+bool writeDDS(const char *const filename, TextureFormat format, int width, int height, int levels, const uchar *const pixels, const usize *const level_offsets) {
+	DdsHeader header = {};
+	header.magic = DDS_MAGIC;
+	header.size = 124;
+	header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000; // caps, height, width, pixel format, mip map count
+	header.height = height;
+	header.width = width;
+	header.mip_map_count = levels;
+	header.pixel_format.size = 32;
+	header.caps = 0x1000 | 0x400000 | 0x8; // texture, mip map, complex
+	DdsHeaderDx10 dx10 = {};
+	switch (format) {
+	case TEXTURE_RGBA8:
+		header.flags |= 0x8; // pitch
+		header.pitch_or_linear_size = width * 4;
+		header.pixel_format.flags = 0x40 | 0x1; // rgb, alpha pixels
+		header.pixel_format.rgb_bit_count = 32;
+		header.pixel_format.r_mask = 0x000000FF;
+		header.pixel_format.g_mask = 0x0000FF00;
+		header.pixel_format.b_mask = 0x00FF0000;
+		header.pixel_format.a_mask = 0xFF000000;
+		break;
+	case TEXTURE_BC1:
+	case TEXTURE_BC3:
+	case TEXTURE_BC7:
+		header.flags |= 0x80000; // linear size
+		header.pitch_or_linear_size = level_offsets[1] - level_offsets[0];
+		header.pixel_format.flags = 0x4; // four cc
+		header.pixel_format.four_cc = ddsFourCC(format == TEXTURE_BC1 ? "DXT1" : format == TEXTURE_BC3 ? "DXT5" : "DX10");
+		dx10 = { DDS_DXGI_FORMAT_BC7_UNORM, 3, 0, 1, 0 }; // texture 2d
+		break;
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (format == TEXTURE_BC7) file.write(reinterpret_cast<const char*>(&dx10), sizeof(dx10));
+	file.write(reinterpret_cast<const char*>(pixels), level_offsets[levels]);
+	return (bool)file;
+}
+
+// where a DDS file's levels are and what they hold
+struct DdsInfo {
+	TextureFormat format;
+	int width;
+	int height;
+	int levels;
+	usize data_offset; // of level 0, the others follow back to back
+};
+
+// by extension, like TextureStreamer picks the loader
+bool isDDSFile(const char *const filename) {
+	const std::string extension = std::filesystem::path(filename).extension().string();
+	return extension == ".dds" || extension == ".DDS";
+}
+
+// false unless `data` is a DDS file in a format we load with every level it claims present
+bool parseDDS(const char *const data, const usize size, DdsInfo *const info) {
+	DdsHeader header;
+	if (size < sizeof(header)) return false;
+	std::memcpy(&header, data, sizeof(header));
+	info->data_offset = sizeof(header);
+
+	bool supported = true;
+	const DdsPixelFormat &pf = header.pixel_format;
+	if ((pf.flags & 0x4) && pf.four_cc == ddsFourCC("DXT1")) {
+		info->format = TEXTURE_BC1;
+	} else if ((pf.flags & 0x4) && pf.four_cc == ddsFourCC("DXT5")) {
+		info->format = TEXTURE_BC3;
+	} else if ((pf.flags & 0x4) && pf.four_cc == ddsFourCC("DX10") && size >= sizeof(header) + sizeof(DdsHeaderDx10)) {
+		DdsHeaderDx10 dx10;
+		std::memcpy(&dx10, data + sizeof(header), sizeof(dx10));
+		info->data_offset += sizeof(dx10);
+		info->format = TEXTURE_BC7;
+		supported = dx10.dxgi_format == DDS_DXGI_FORMAT_BC7_UNORM && dx10.array_size == 1;
+	} else if ((pf.flags & 0x40) && pf.rgb_bit_count == 32 && pf.r_mask == 0xFF && pf.g_mask == 0xFF00 && pf.b_mask == 0xFF0000) {
+		info->format = TEXTURE_RGBA8;
+	} else {
+		supported = false;
+	}
+
+	// bound the size before summing levels: at TEXTURE_MAX_SIZE a full RGBA8 chain is ~1.4 GB,
+	// far from overflowing
+	if (header.magic != DDS_MAGIC || !supported || header.width == 0 || header.height == 0
+		|| header.width > TEXTURE_MAX_SIZE || header.height > TEXTURE_MAX_SIZE) return false;
+	const int width = header.width, height = header.height;
+	const int levels = std::max(1u, header.mip_map_count);
+	if (header.mip_map_count > (uint)textureFullLevels(width, height)) return false;
+	const std::vector<usize> offsets = textureLevelOffsets(info->format, width, height, levels);
+	if (size < info->data_offset || size - info->data_offset < offsets.back()) return false;
+	info->width = width;
+	info->height = height;
+	info->levels = levels;
+	return true;
+}
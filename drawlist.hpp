@@ -0,0 +1,160 @@
+#pragma once
+#include <vector>
+
+// what a multi-draw shares, draws with different materials go to separate glMultiDraw*Indirect calls
+struct Material {
+	uint program;
+	uint vao;
+	GLenum index_type; // 0 for glMultiDrawArraysIndirect
+
+	bool operator==(const Material &other) const {
+		return this->program == other.program && this->vao == other.vao && this->index_type == other.index_type;
+	}
+};
+
+// std430, matches `Draw` in 3d.vert, fetched with gl_DrawID
+struct DrawData {
+	uint first_instance; // into Instances
+};
+
+// Per-frame scene submission. Draws are recorded on the CPU, then submit() writes their indirect
+// commands and per-draw data into a persistently mapped ring (SlotFences, like UniformRing) and
+// issues one glMultiDraw*Indirect per material, so the driver cost per frame doesn't grow with the
+// draw count. Commands can also come from a GPU buffer, e.g. written by a culling or mesh compute pass.
+// Without GL_ARB_shader_draw_parameters there's no gl_DrawID, so each draw is issued on its own with
+// its index in a uniform instead: same buffers, same shader, one call per draw.
+struct DrawList {
+	static constexpr usize slots = SlotFences::slots;
+	static constexpr uint draws_binding = 6; // Draws in 3d.vert
+	static constexpr int draw_id_location = 0; // drawID in 3d.vert, without draw parameters
+	// both command layouts in one array: DrawArraysIndirectCommand is a prefix of this size
+	static constexpr usize command_stride = sizeof(DrawElementsIndirectCommand);
+
+	struct Draw {
+		Material material;
+		DrawElementsIndirectCommand command;
+		DrawData data;
+		uint src_buffer; // copy the command from here on the GPU instead, 0 if none
+		usize src_offset;
+	};
+
+	bool draw_parameters;
+	uint buffer;
+	uchar *data;
+	usize max_draws;
+	usize data_offset; // of the DrawData array within a slot
+	usize data_align; // in DrawData elements, for glBindBufferRange
+	usize stride;
+	SlotFences fences;
+	std::vector<Draw> draws;
+
+	static bool drawParametersSupported() {
+		return GLAD_GL_ARB_shader_draw_parameters;
+	}
+
+	// shader defines matching init(), for ProgramBuild::init
+	static std::string defines(bool draw_parameters) {
+		return draw_parameters ? "#define DRAW_PARAMETERS\n" : "";
+	}
+
+	// `draw_parameters` only if drawParametersSupported()
+	static DrawList init(uint buffer, usize max_draws, bool draw_parameters) {
+		DrawList list = {};
+		list.draw_parameters = draw_parameters;
+		int ssbo_align;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &ssbo_align);
+		list.buffer = buffer;
+		list.max_draws = max_draws;
+		list.data_align = std::max<usize>(1, ssbo_align / sizeof(DrawData));
+		list.data_offset = (command_stride*max_draws + ssbo_align - 1) / ssbo_align * ssbo_align;
+		// every material may need its data start padded to the alignment
+		const usize data_size = sizeof(DrawData) * max_draws * (1 + list.data_align);
+		list.stride = (list.data_offset + data_size + ssbo_align - 1) / ssbo_align * ssbo_align;
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glNamedBufferStorage(buffer, list.stride * slots, nullptr, flags);
+		list.data = reinterpret_cast<uchar*>(glMapNamedBufferRange(buffer, 0, list.stride * slots, flags));
+		return list;
+	}
+
+	void deinit() {
+		this->fences.deinit();
+		glUnmapNamedBuffer(this->buffer);
+		this->data = nullptr;
+	}
+
+	// false (and the draw is dropped) once max_draws are recorded this frame
+	bool draw(const Material &material, const DrawElementsIndirectCommand &command) {
+		if (this->draws.size() == this->max_draws) return false;
+		this->draws.push_back(Draw{ material, command, DrawData{ command.base_instance }, 0, 0 });
+		return true;
+	}
+
+	bool draw(const Material &material, const DrawArraysIndirectCommand &command) {
+		DrawElementsIndirectCommand padded = {};
+		std::memcpy(&padded, &command, sizeof(command));
+		return this->draw(material, padded);
+	}
+
+	// the command is read from `src_buffer` at submit(), after any GPU writes issued before it;
+	// shader writes to it need a GL_BUFFER_UPDATE_BARRIER_BIT barrier first
+	bool drawIndirect(const Material &material, uint src_buffer, usize src_offset, uint first_instance) {
+		if (this->draws.size() == this->max_draws) return false;
+		this->draws.push_back(Draw{ material, {}, DrawData{ first_instance }, src_buffer, src_offset });
+		return true;
+	}
+
+	// issues every recorded draw and clears the list
+	void submit() {
+		PROFILE_SCOPE("submit draws");
+		const usize slot = this->fences.next();
+		// group by material, keeping the recorded order within each
+		std::stable_sort(this->draws.begin(), this->draws.end(), [](const Draw &a, const Draw &b) {
+			if (a.material.program != b.material.program) return a.material.program < b.material.program;
+			if (a.material.vao != b.material.vao) return a.material.vao < b.material.vao;
+			return a.material.index_type < b.material.index_type;
+		});
+
+		const usize slot_offset = slot * this->stride;
+		uchar *const commands = this->data + slot_offset;
+		DrawData *const draw_data = reinterpret_cast<DrawData*>(this->data + slot_offset + this->data_offset);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->buffer);
+		usize data_at = 0;
+		for (usize first = 0; first < this->draws.size();) {
+			const Material material = this->draws[first].material;
+			usize last = first;
+			for (; last < this->draws.size() && this->draws[last].material == material; last++) {
+				const Draw &draw = this->draws[last];
+				std::memcpy(commands + last*command_stride, &draw.command, command_stride);
+				draw_data[data_at + last - first] = draw.data;
+				if (draw.src_buffer != 0) {
+					glCopyNamedBufferSubData(draw.src_buffer, this->buffer, draw.src_offset, slot_offset + last*command_stride, command_stride);
+				}
+			}
+			// gl_DrawID restarts at 0 for every call, so each material sees its own slice
+			const usize count = last - first;
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, draws_binding, this->buffer, slot_offset + this->data_offset + data_at*sizeof(DrawData), count*sizeof(DrawData));
+			glUseProgram(material.program);
+			glBindVertexArray(material.vao);
+			const usize indirect = slot_offset + first*command_stride;
+			if (!this->draw_parameters) {
+				for (usize i = 0; i < count; i++) {
+					glUniform1i(draw_id_location, i);
+					const void *const command = reinterpret_cast<const void*>(indirect + i*command_stride);
+					if (material.index_type == 0) {
+						glDrawArraysIndirect(GL_TRIANGLES, command);
+					} else {
+						glDrawElementsIndirect(GL_TRIANGLES, material.index_type, command);
+					}
+				}
+			} else if (material.index_type == 0) {
+				glMultiDrawArraysIndirect(GL_TRIANGLES, reinterpret_cast<const void*>(indirect), count, command_stride);
+			} else {
+				glMultiDrawElementsIndirect(GL_TRIANGLES, material.index_type, reinterpret_cast<const void*>(indirect), count, command_stride);
+			}
+			data_at = (data_at + count + this->data_align - 1) / this->data_align * this->data_align;
+			first = last;
+		}
+		this->fences.fence();
+		this->draws.clear();
+	}
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+// Generates the prism with prism.comp straight into the VBO/EBO plus an indirect draw command,
+// so changing the face count never runs genVerts or uploads anything from the CPU.
+struct GpuMesh {
+	uint program;
+	uint cmd; // DrawElementsIndirectCommand
+	usize vbo_capacity;
+	usize ebo_capacity;
+	GLenum index_type;
+
+	static GpuMesh init(uint cmd, const char *const comp_filename) {
+		GpuMesh mesh = {};
+		mesh.program = createComputeShader(comp_filename);
+		mesh.cmd = cmd;
+		glNamedBufferStorage(cmd, sizeof(uint)*5, nullptr, 0);
+		return mesh;
+	}
+
+	void deinit() {
+		glDeleteProgram(this->program);
+		this->program = 0;
+	}
+
+	void generate(uint vbo, uint ebo, const VertexFormat &fmt, int faces, int instances) {
+		PROFILE_SCOPE("gpu mesh generate");
+		const usize vertex_count = faces*6;
+		const usize index_count = prismTris(faces)*3;
+		this->index_type = Mesh::indexType(vertex_count);
+		const usize vbo_size = fmt.stride * vertex_count;
+		const usize ebo_size = Mesh::indexSize(this->index_type) * index_count;
+		// grow only, fewer faces just use a prefix
+		if (vbo_size > this->vbo_capacity) {
+			glNamedBufferData(vbo, vbo_size, nullptr, GL_DYNAMIC_DRAW);
+			this->vbo_capacity = vbo_size;
+		}
+		if (ebo_size > this->ebo_capacity) {
+			glNamedBufferData(ebo, ebo_size, nullptr, GL_DYNAMIC_DRAW);
+			this->ebo_capacity = ebo_size;
+		}
+
+		glProgramUniform1i(this->program, 0, faces);
+		glProgramUniform1i(this->program, 1, fmt.encoding);
+		glProgramUniform1i(this->program, 2, fmt.stride / sizeof(uint));
+		glProgramUniform1i(this->program, 3, this->index_type == GL_UNSIGNED_SHORT);
+		glProgramUniform1i(this->program, 4, instances);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, vbo);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, ebo);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, this->cmd);
+		glUseProgram(this->program);
+		glDispatchCompute((faces + 63) / 64, 1, 1);
+		// the command is drawn from directly or copied into a DrawList
+		glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	}
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include <array>
+#include <vector>
+
+// Per-pass GPU times from GL_TIMESTAMP query pairs. Queries live in a ring of `frames` slots and a
+// slot is only read back when it comes round again, several frames after it was submitted, so
+// reading results never stalls; a slot that still isn't ready is skipped rather than waited on.
+// Each pass is also wrapped in a debug group of the same name for external tools (RenderDoc, apitrace).
+struct GpuTimer {
+	static constexpr usize frames = 4;
+	static constexpr usize max_passes = 8;
+	static constexpr usize window = 64; // samples in the rolling average
+
+	struct Pass {
+		const char *name;
+		std::array<double, window> samples_ms;
+		usize count;
+	};
+
+	struct Slot {
+		std::array<uint, max_passes*2> queries;
+		std::array<usize, max_passes> passes; // index into `passes` for each recorded pair
+		usize recorded;
+	};
+
+	std::vector<Pass> passes;
+	std::array<Slot, frames> slots;
+	usize slot;
+	usize open; // pass index of the current begin(), or max_passes
+
+	static GpuTimer init() {
+		GpuTimer timer = {};
+		for (Slot &slot : timer.slots) {
+			glCreateQueries(GL_TIMESTAMP, slot.queries.size(), slot.queries.data());
+		}
+		timer.open = max_passes;
+		return timer;
+	}
+
+	void deinit() {
+		for (Slot &slot : this->slots) {
+			glDeleteQueries(slot.queries.size(), slot.queries.data());
+		}
+	}
+
+	// call before the first pass of a frame
+	void beginFrame() {
+		this->slot = (this->slot + 1) % frames;
+		this->collect(&this->slots[this->slot], false);
+	}
+
+	// waits for every outstanding result, e.g. before the final report()
+	void flush() {
+		for (usize i = 1; i <= frames; i++) {
+			this->collect(&this->slots[(this->slot + i) % frames], true);
+		}
+	}
+
+	// adds the slot's results to the averages and empties it; without `wait` only if they're ready
+	void collect(Slot *const slot, bool wait) {
+		if (slot->recorded > 0 && !wait) {
+			int available = 0;
+			glGetQueryObjectiv(slot->queries[slot->recorded*2 - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) slot->recorded = 0;
+		}
+		for (usize i = 0; i < slot->recorded; i++) {
+			GLuint64 begin, end;
+			glGetQueryObjectui64v(slot->queries[i*2 + 0], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(slot->queries[i*2 + 1], GL_QUERY_RESULT, &end);
+			Pass &pass = this->passes[slot->passes[i]];
+			pass.samples_ms[pass.count++ % window] = (double)(end - begin) / 1e6;
+		}
+		slot->recorded = 0;
+	}
+
+	// `name` must outlive the timer, e.g. a string literal; passes don't nest
+	void begin(const char *const name) {
+		Slot &slot = this->slots[this->slot];
+		if (slot.recorded == max_passes) return;
+		usize index = 0;
+		while (index < this->passes.size() && this->passes[index].name != name) index++;
+		if (index == this->passes.size()) {
+			if (index == max_passes) return;
+			this->passes.push_back(Pass{ .name = name });
+		}
+		glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, index, -1, name);
+		slot.passes[slot.recorded] = index;
+		glQueryCounter(slot.queries[slot.recorded*2 + 0], GL_TIMESTAMP);
+		this->open = index;
+	}
+
+	void end() {
+		if (this->open == max_passes) return;
+		Slot &slot = this->slots[this->slot];
+		glQueryCounter(slot.queries[slot.recorded*2 + 1], GL_TIMESTAMP);
+		glPopDebugGroup();
+		slot.recorded++;
+		this->open = max_passes;
+	}
+
+	// rolling average over the last `window` frames, 0 if the pass has no results yet
+	double ms(const char *const name) const {
+		for (const Pass &pass : this->passes) {
+			if (pass.name != name || pass.count == 0) continue;
+			const usize n = std::min(pass.count, window);
+			double total = 0.0;
+			for (usize i = 0; i < n; i++) total += pass.samples_ms[i];
+			return total / (double)n;
+		}
+		return 0.0;
+	}
+
+	void report() const {
+		std::cout << "gpu:";
+		for (const Pass &pass : this->passes) {
+			std::cout << " " << pass.name << " " << this->ms(pass.name) << " ms";
+		}
+		std::cout << std::endl;
+	}
+};
@@ -0,0 +1,130 @@
+#pragma once
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+// Offscreen GL context for benchmarking on machines without a display (e.g. Mesa llvmpipe in CI).
+// Everything renders into `fbo`, which stays bound for the lifetime of the context.
+struct Headless {
+	EGLDisplay display;
+	EGLContext context;
+	uint fbo;
+	uint color_rb;
+	uint depth_rb;
+	ivec2 res;
+};
+
+Headless initHeadless(int width, int height) {
+	Headless headless = {};
+	headless.res = ivec2(width, height);
+
+	// prefer the surfaceless platform so no X/Wayland/GBM device is needed at all
+	auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	headless.display = EGL_NO_DISPLAY;
+	if (getPlatformDisplay != nullptr) {
+		headless.display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (headless.display == EGL_NO_DISPLAY) {
+		headless.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major, minor;
+	if (headless.display == EGL_NO_DISPLAY || !eglInitialize(headless.display, &major, &minor)) {
+		std::cout << "Failed to initialize EGL" << std::endl;
+		exit(-1);
+	}
+	std::cout << "EGL " << major << "." << minor << std::endl;
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		std::cout << "Failed to bind EGL OpenGL API" << std::endl;
+		exit(-1);
+	}
+	const EGLint context_attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE,
+	};
+	// EGL_KHR_no_config_context + EGL_KHR_surfaceless_context
+	headless.context = eglCreateContext(headless.display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, context_attribs);
+	if (headless.context == EGL_NO_CONTEXT) {
+		std::cout << "Failed to create EGL context (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+		eglTerminate(headless.display);
+		exit(-1);
+	}
+	if (!eglMakeCurrent(headless.display, EGL_NO_SURFACE, EGL_NO_SURFACE, headless.context)) {
+		std::cout << "Failed to make EGL context current" << std::endl;
+		exit(-1);
+	}
+
+	int version = gladLoadGL(eglGetProcAddress);
+	if (version == 0) {
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		exit(-1);
+	}
+	std::cout << "GL " << GLAD_VERSION_MAJOR(version) << "." << GLAD_VERSION_MINOR(version) << std::endl;
+	std::cout << glGetString(GL_RENDERER) << std::endl;
+
+	glCreateRenderbuffers(1, &headless.color_rb);
+	glNamedRenderbufferStorage(headless.color_rb, GL_RGBA8, width, height);
+	glCreateRenderbuffers(1, &headless.depth_rb);
+	glNamedRenderbufferStorage(headless.depth_rb, GL_DEPTH_COMPONENT24, width, height);
+	glCreateFramebuffers(1, &headless.fbo);
+	glNamedFramebufferRenderbuffer(headless.fbo, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headless.color_rb);
+	glNamedFramebufferRenderbuffer(headless.fbo, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, headless.depth_rb);
+	if (glCheckNamedFramebufferStatus(headless.fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "Failed to create headless framebuffer" << std::endl;
+		exit(-1);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, headless.fbo);
+	glViewport(0, 0, width, height);
+
+	setupGLContext();
+
+	return headless;
+}
+
+void deinitHeadless(Headless *headless) {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &headless->fbo);
+	glDeleteRenderbuffers(1, &headless->color_rb);
+	glDeleteRenderbuffers(1, &headless->depth_rb);
+	eglMakeCurrent(headless->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(headless->display, headless->context);
+	eglTerminate(headless->display);
+	*headless = {};
+}
+
+// writes the bound framebuffer as a binary PPM, e.g. for pixel diffs between render paths
+void dumpFramebuffer(const char *const filename, const ivec2 res) {
+	std::vector<uchar> pixels(res.x * res.y * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, res.x, res.y, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		std::cout << "Failed to open " << filename << std::endl;
+		return;
+	}
+	file << "P6\n" << res.x << " " << res.y << "\n255\n";
+	for (int y = res.y - 1; y >= 0; y--) { // GL rows are bottom-up
+		file.write(reinterpret_cast<const char*>(pixels.data() + y*res.x*3), res.x*3);
+	}
+}
+
+// frame_ms is sorted in place
+void printFrameStats(std::vector<double> &frame_ms, usize tris_per_frame) {
+	if (frame_ms.empty()) return;
+	std::sort(frame_ms.begin(), frame_ms.end());
+	double total = 0.0;
+	for (double ms : frame_ms) total += ms;
+	const usize n = frame_ms.size();
+	const double fps = (double)n / (total / 1000.0);
+	std::cout << "frames: " << n << std::endl;
+	std::cout << "min: " << frame_ms.front() << " ms" << std::endl;
+	std::cout << "median: " << frame_ms[n/2] << " ms" << std::endl;
+	std::cout << "p99: " << frame_ms[std::min(n - 1, n*99/100)] << " ms" << std::endl;
+	std::cout << "throughput: " << fps << " fps, " << fps * (double)tris_per_frame / 1e6 << " Mtris/s" << std::endl;
+}
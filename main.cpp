@@ -7,6 +7,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
 
@@ -17,8 +18,25 @@
 #include <iostream>
 #include <vector>
 #include <array>
+#include <cstring>
+#include <string>
 
+#include "profiler.hpp"
 #include "utils.hpp"
+#include "headless.hpp"
+#include "prism.hpp"
+#include "gpumesh.hpp"
+#include "drawlist.hpp"
+#include "meshcache.hpp"
+#include "meshbuilder.hpp"
+#include "gputimer.hpp"
+#include "triplebuffer.hpp"
+#include "spscqueue.hpp"
+#include "shaderwatch.hpp"
+#include "texcompress.hpp"
+#include "dds.hpp"
+#include "texturestream.hpp"
+#include "textureset.hpp"
 
 using glm::mat4, glm::vec2, glm::vec3, glm::vec4, glm::uvec2, glm::ivec2;
 namespace chrono = std::chrono;
@@ -41,6 +59,17 @@ struct UniformBuffer {
 	vec4 light_clr;
 	vec4 ambient_clr;
 	float ambient_str;
+	float rot;
+	int faces; // > 0 makes 3d.vert generate the prism from gl_VertexID instead of reading attributes
+};
+
+// std430, matches `Instance` in 3d.vert
+struct Instance {
+	vec4 offset_scale; // xyz offset, w uniform scale
+	vec4 clr;
+	vec2 spin; // x phase in degrees, y multiplier of the global rotation
+	int tex; // index into the TextureSet, -1 for untextured
+	int pad;
 };
 
 struct View {
@@ -62,12 +91,41 @@ struct Keys {
 	bool q;
 	bool space;
 	bool shift;
-	bool tab;
 	bool red;
 	bool green;
 	bool blue;
 };
 
+enum InputType {
+	INPUT_KEY,
+	INPUT_MOUSE_BUTTON,
+	INPUT_CURSOR,
+	INPUT_WINDOW_SIZE,
+	INPUT_FRAMEBUFFER_SIZE,
+};
+
+// one GLFW callback, queued from the main thread to the simulation thread
+struct InputEvent {
+	InputType type;
+	int code;   // GLFW key or mouse button
+	int action; // GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+	double x;   // cursor position, or width/height
+	double y;
+	chrono::steady_clock::time_point time;
+};
+
+// the GLFW window user pointer, written by the input callbacks only
+typedef SpscQueue<InputEvent, 1024> InputQueue;
+
+enum MeshSource {
+	MESH_CPU,        // genPrism on a worker thread, cached per face count
+	MESH_PROCEDURAL, // bufferless, 3d.vert builds vertices from gl_VertexID
+	MESH_COMPUTE,    // prism.comp writes the VBO/EBO
+};
+
+constexpr float SIM_STEP_MS = 1000.0f/120.0f;
+constexpr double MAX_LAG_MS = 250.0;
+
 enum Mode {
 	CAM,
 	LIGHT,
@@ -79,16 +137,19 @@ struct State {
 	View view;
 	vec3 cam_pos;
 	ivec2 scr_res;
+	ivec2 fb_res;
 	int faces;
-	float dt;
+	int instances;
+	MeshSource mesh_source;
 	float rot_speed;
 	float rot;
 	Keys keys;
 	Mode mode;
 
-	static State init(GLFWwindow *const window) {
+	static State init(const ivec2 scr_res) {
 		State state = {};
 		state.faces = 4;
+		state.instances = 1;
 		state.rot_speed = 0.04f;
 		state.mouse = {
 			.sens = 0.1f,
@@ -109,8 +170,7 @@ struct State {
 			.ambient_clr = vec4(1.0f),
 			.ambient_str = 0.1f,
 		};
-		glfwGetWindowSize(window, &state.scr_res.x, &state.scr_res.y);
-		glfwGetCursorPos(window, &state.mouse.last_xpos, &state.mouse.last_ypos);
+		state.scr_res = scr_res;
 		state.updateUB();
 		return state;
 	}
@@ -121,390 +181,681 @@ struct State {
 		this->ub.model = glm::rotate(mat4(1.0f), glm::radians(this->rot), vec3(0.0f, 1.0f, 0.0f));
 		this->ub.model_it = glm::transpose(glm::inverse(this->ub.model));
 		this->ub.view_pos = vec4(this->view.pos, 0.0f);
+		this->ub.rot = this->rot;
+		this->ub.faces = this->mesh_source == MESH_PROCEDURAL ? this->faces : 0;
 	}
 
-	void uploadUB(uint ubo) const {
-		glNamedBufferSubData(ubo, 0, sizeof(UniformBuffer), &this->ub);
+	void uploadUB(UniformRing &ub_ring) const {
+		ub_ring.push(0, &this->ub);
 	}
-};
-
-std::vector<Vertex> genVerts(uint vbo, int faces);
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
-void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
-void cursorPosCallback(GLFWwindow* window, double xpos, double ypos);
-void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
-void windowSizeCallback(GLFWwindow* window, int width, int height);
 
-int main() {
-	GLFWwindow *window = init();
-	State state = State::init(window);
-	glfwSetWindowUserPointer(window, reinterpret_cast<void *>(&state));
-	glfwSetKeyCallback(window, keyCallback);
-	glfwSetMouseButtonCallback(window, mouseButtonCallback);
-	glfwSetCursorPosCallback(window, cursorPosCallback);
-	glfwSetScrollCallback(window, scrollCallback);
-	glfwSetWindowSizeCallback(window, windowSizeCallback);
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-	// Initialize buffers
-	std::array<uint, 1> va{};
-	std::array<uint, 3> b{};
-	allocBuffers(va.size(), va.data(), b.size(), b.data());
-	const uint vao = va[0];
-	const uint vbo = b[0];
-	const uint ebo = b[1];
-	const uint ubo = b[2];
-
-	glVertexArrayElementBuffer(vao, ebo);
-	glVertexArrayVertexBuffer(vao, 0, vbo, 0, sizeof(Vertex));
-	glEnableVertexArrayAttrib(vao, 0);
-	glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, pos));
-	glVertexArrayAttribBinding(vao, 0, 0);
-	glEnableVertexArrayAttrib(vao, 1);
-	glVertexArrayAttribFormat(vao, 1, 4, GL_FLOAT, GL_FALSE, offsetof(Vertex, clr));
-	glVertexArrayAttribBinding(vao, 1, 0);
-	glEnableVertexArrayAttrib(vao, 2);
-	glVertexArrayAttribFormat(vao, 2, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, norm));
-	glVertexArrayAttribBinding(vao, 2, 0);
-	glEnableVertexArrayAttrib(vao, 3);
-	glVertexArrayAttribFormat(vao, 3, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, uv));
-	glVertexArrayAttribBinding(vao, 3, 0);
-
-	std::vector<Vertex> vertices = genVerts(vbo, state.faces);
-	const std::array<uint, 0> indices = {}; // not in use
-	glNamedBufferData(ebo, sizeof(uint)*indices.size(), indices.data(), GL_STATIC_DRAW);
-	glNamedBufferData(ubo, sizeof(UniformBuffer), &state.ub, GL_DYNAMIC_DRAW);
-
-	// Initialize shaders
-	const uint shader = createShader("./3d.vert", "./3d.frag");
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, ubo);
-
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);
-
-	State prev_state = state;
-	auto start = chrono::steady_clock::now();
-	while (!glfwWindowShouldClose(window)) {
-		prev_state = state;
-		auto now = chrono::steady_clock::now();
-		state.dt = chrono::duration_cast<chrono::milliseconds>(now - start).count();
-		start = now;
-
-		{ // process
-			glfwPollEvents();
-			const float dt = state.dt;
-			const float clr_speed = 0.0005f;
-
-			if (state.keys.tab) {
-				switch (state.mode) {
+	// one input event from the main thread, applied in the order they happened
+	void applyEvent(const InputEvent &event) {
+		switch (event.type) {
+		case INPUT_KEY: {
+			if (event.action == GLFW_REPEAT) break;
+			const bool pressed = event.action == GLFW_PRESS;
+			switch (event.code) {
+			case GLFW_KEY_W: this->keys.w = pressed; break;
+			case GLFW_KEY_S: this->keys.s = pressed; break;
+			case GLFW_KEY_A: this->keys.a = pressed; break;
+			case GLFW_KEY_D: this->keys.d = pressed; break;
+			case GLFW_KEY_E: this->keys.e = pressed; break;
+			case GLFW_KEY_Q: this->keys.q = pressed; break;
+			case GLFW_KEY_SPACE: this->keys.space = pressed; break;
+			case GLFW_KEY_LEFT_SHIFT: this->keys.shift = pressed; break;
+			case GLFW_KEY_1: this->keys.red = pressed; break;
+			case GLFW_KEY_2: this->keys.green = pressed; break;
+			case GLFW_KEY_3: this->keys.blue = pressed; break;
+			case GLFW_KEY_TAB:
+				if (!pressed) break;
+				switch (this->mode) {
 				case LIGHT:
-					state.mode = CAM;
-					state.view.pos = state.cam_pos;
+					this->mode = CAM;
+					this->view.pos = this->cam_pos;
 					break;
 				case CAM:
-					state.mode = LIGHT;
-					state.view.pos = state.ub.light_pos;
+					this->mode = LIGHT;
+					this->view.pos = this->ub.light_pos;
 					break;
 				}
-				state.keys.tab = false;
+				break;
 			}
-
-			if (state.keys.w) state.view.pos += state.view.front * state.view.speed * dt;
-			if (state.keys.s) state.view.pos -= state.view.front * state.view.speed * dt;
-			if (state.keys.a) state.view.pos -= glm::normalize(glm::cross(state.view.front, state.view.up)) * state.view.speed * dt;
-			if (state.keys.d) state.view.pos += glm::normalize(glm::cross(state.view.front, state.view.up)) * state.view.speed * dt;
-			if (state.keys.space) state.view.pos += state.view.up * state.view.speed * dt;
-			if (state.keys.shift) state.view.pos -= state.view.up * state.view.speed * dt;
-			switch (state.mode) {
-			case LIGHT:
-				state.ub.light_pos = vec4(state.view.pos, state.ub.light_pos.w);
-				if (state.keys.left_click) {
-					state.ub.ambient_str += clr_speed * dt;
-				}
-				if (state.keys.right_click) {
-					state.ub.ambient_str -= clr_speed * dt;
-				}
+			break;
+		}
+		case INPUT_MOUSE_BUTTON: {
+			const bool pressed = event.action == GLFW_PRESS;
+			// in camera mode each click changes the face count, in light mode holding changes ambient
+			switch (event.code) {
+			case GLFW_MOUSE_BUTTON_LEFT:
+				this->keys.left_click = pressed;
+				if (pressed && this->mode == CAM) this->faces += 1;
 				break;
-			case CAM:
-				state.cam_pos = vec3(state.view.pos);
-				if (state.keys.left_click) {
-					state.faces += 1;
-					vertices = genVerts(vbo, state.faces);
-					state.keys.left_click = false;
-				}
-				if (state.keys.right_click) {
-					if (state.faces > 3) state.faces -= 1;
-					vertices = genVerts(vbo, state.faces);
-					state.keys.right_click = false;
-				}
+			case GLFW_MOUSE_BUTTON_RIGHT:
+				this->keys.right_click = pressed;
+				if (pressed && this->mode == CAM && this->faces > 3) this->faces -= 1;
 				break;
 			}
-
-			if (state.keys.q) state.rot -= state.rot_speed * dt;
-			if (state.keys.e) state.rot += state.rot_speed * dt;
-
-			if (state.keys.red) {
-				state.ub.light_clr.x += clr_speed * dt;
-				while (state.ub.light_clr.x > 1.0f) state.ub.light_clr.x -= 1.0f;
-			}
-			if (state.keys.green) {
-				state.ub.light_clr.y += clr_speed * dt;
-				while (state.ub.light_clr.y > 1.0f) state.ub.light_clr.y -= 1.0f;
-			}
-			if (state.keys.blue) {
-				state.ub.light_clr.z += clr_speed * dt;
-				while (state.ub.light_clr.z > 1.0f) state.ub.light_clr.z -= 1.0f;
-			}
-			state.updateUB();
-			state.uploadUB(ubo);
+			break;
 		}
-		{ // render
-			glClearColor(0.0f, 0.0f, 0.0f, 1.00f);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-			glUseProgram(shader);
-			glBindVertexArray(vao);
-			glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+		case INPUT_CURSOR: {
+			double xoffset =  (event.x - this->mouse.last_xpos) * this->mouse.sens;
+			double yoffset = -(event.y - this->mouse.last_ypos) * this->mouse.sens;
+			this->mouse.last_xpos = event.x;
+			this->mouse.last_ypos = event.y;
+
+			this->mouse.yaw = this->mouse.yaw + xoffset;
+			this->mouse.pitch = std::clamp(this->mouse.pitch + yoffset, -89.0d, 89.0d);
+			this->view.front = glm::normalize(vec3(
+				std::cos(glm::radians(this->mouse.yaw)) * std::cos(glm::radians(this->mouse.pitch)),
+				std::sin(glm::radians(this->mouse.pitch)),
+				std::sin(glm::radians(this->mouse.yaw)) * std::cos(glm::radians(this->mouse.pitch))
+			));
+			break;
+		}
+		case INPUT_WINDOW_SIZE:
+			this->scr_res = ivec2(event.x, event.y);
+			break;
+		case INPUT_FRAMEBUFFER_SIZE:
+			this->fb_res = ivec2(event.x, event.y);
+			break;
 		}
-		glfwSwapBuffers(window);
 	}
 
-	glDeleteProgram(shader);
-	freeBuffers(va.size(), va.data(), b.size(), b.data());
-	deinit(&window);
-	return 0;
-}
+	// advances `dt` ms while applying every queued event up to `until` at the point in the step it
+	// happened, so a key held for half a step moves half as far
+	void stepEvents(float dt, chrono::steady_clock::time_point until, InputQueue *const inputs) {
+		auto t = until - chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<float, std::milli>(dt));
+		while (const InputEvent *event = inputs->peek()) {
+			if (event->time > until) break;
+			if (event->time > t) {
+				this->step(chrono::duration<float, std::milli>(event->time - t).count());
+				t = event->time;
+			}
+			this->applyEvent(*event);
+			inputs->pop();
+		}
+		this->step(chrono::duration<float, std::milli>(until - t).count());
+	}
 
-void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-	State *state = reinterpret_cast<State*>(glfwGetWindowUserPointer(window));
-	switch (key) {
-	case GLFW_KEY_W:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.w = true;
+	// advances everything that moves continuously by `dt` ms, always SIM_STEP_MS from the main loop
+	void step(float dt) {
+		const float clr_speed = 0.0005f;
+		const vec3 right = glm::normalize(glm::cross(this->view.front, this->view.up));
+		if (this->keys.w) this->view.pos += this->view.front * this->view.speed * dt;
+		if (this->keys.s) this->view.pos -= this->view.front * this->view.speed * dt;
+		if (this->keys.a) this->view.pos -= right * this->view.speed * dt;
+		if (this->keys.d) this->view.pos += right * this->view.speed * dt;
+		if (this->keys.space) this->view.pos += this->view.up * this->view.speed * dt;
+		if (this->keys.shift) this->view.pos -= this->view.up * this->view.speed * dt;
+		switch (this->mode) {
+		case LIGHT:
+			this->ub.light_pos = vec4(this->view.pos, this->ub.light_pos.w);
+			if (this->keys.left_click) this->ub.ambient_str += clr_speed * dt;
+			if (this->keys.right_click) this->ub.ambient_str -= clr_speed * dt;
 			break;
-		case GLFW_RELEASE:
-			state->keys.w = false;
+		case CAM:
+			this->cam_pos = this->view.pos;
 			break;
 		}
-		break;
-	case GLFW_KEY_S:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.s = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.s = false;
-			break;
+
+		if (this->keys.q) this->rot -= this->rot_speed * dt;
+		if (this->keys.e) this->rot += this->rot_speed * dt;
+
+		const std::array<bool, 3> ramps = { this->keys.red, this->keys.green, this->keys.blue };
+		for (int c = 0; c < 3; c++) {
+			if (!ramps[c]) continue;
+			this->ub.light_clr[c] += clr_speed * dt;
+			while (this->ub.light_clr[c] > 1.0f) this->ub.light_clr[c] -= 1.0f;
 		}
-		break;
-	case GLFW_KEY_A:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.a = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.a = false;
-			break;
+	}
+
+	// this state blended with `prev`, the state one step earlier, for rendering between steps
+	State interpolate(const State &prev, float alpha) const {
+		State state = *this;
+		// switching mode teleports the view, don't sweep across the scene
+		if (prev.mode == this->mode) state.view.pos = glm::mix(prev.view.pos, this->view.pos, alpha);
+		state.rot = glm::mix(prev.rot, this->rot, alpha);
+		state.ub.light_pos = glm::mix(prev.ub.light_pos, this->ub.light_pos, alpha);
+		state.ub.ambient_str = glm::mix(prev.ub.ambient_str, this->ub.ambient_str, alpha);
+		for (int c = 0; c < 3; c++) {
+			// the color ramps wrap from 1 back to 0, blend across the wrap instead of through the range
+			float from = prev.ub.light_clr[c], to = this->ub.light_clr[c];
+			if (to < from) to += 1.0f;
+			const float clr = glm::mix(from, to, alpha);
+			state.ub.light_clr[c] = clr > 1.0f ? clr - 1.0f : clr;
 		}
-		break;
-	case GLFW_KEY_D:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.d = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.d = false;
-			break;
+		return state;
+	}
+
+	// headless stand-in for the input callbacks: orbit the prism once over `frames` while spinning it
+	void scriptFrame(int frame, int frames) {
+		const float angle = (float)frame / (float)frames * 2.0f*M_PI;
+		this->view.pos = vec3(2.0f * std::sin(angle), 0.5f, 2.0f * std::cos(angle));
+		this->view.front = glm::normalize(-this->view.pos);
+		this->keys.e = true;
+	}
+};
+
+struct Options {
+	bool headless;
+	int frames;
+	int faces;
+	int instances;
+	VertexEncoding vertex_encoding;
+	MeshSource mesh_source;
+	const char *dump;
+	bool bench_genverts;
+	usize mesh_cache_mb;
+	bool gpu_times;
+	const char *trace;
+	std::vector<const char*> textures;
+	TextureFormat texture_format;
+	bool bindless;
+	bool draw_parameters;
+};
+
+Options parseOptions(int argc, char **argv);
+Mesh genVerts(MeshCache *const cache, const VertexFormat &fmt, int faces);
+void genInstances(uint ssbo, int count, int textures);
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+void cursorPosCallback(GLFWwindow* window, double xpos, double ypos);
+void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
+void windowSizeCallback(GLFWwindow* window, int width, int height);
+void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+
+// Owns every GL object and draws States, on whichever thread has the context current.
+struct Renderer {
+	std::array<uint, 2> va;
+	std::array<uint, 6> b;
+	uint vao;
+	uint empty_vao; // bufferless draws still need a VAO bound in core profile
+	uint vbo;
+	uint ebo;
+	uint ubo;
+	uint ssbo;
+	uint cmd;
+	uint draws;
+	TextureSet texture_set; // --texture files
+	VertexFormat vertex_format;
+	MeshSource mesh_source;
+	int faces;
+	Mesh mesh;
+	int mesh_faces; // face count of `mesh`, which may lag behind `faces` while it rebuilds
+	MeshCache mesh_cache;
+	MeshBuilder mesh_builder;
+	GpuMesh gpu_mesh;
+	UniformRing ub_ring;
+	DrawList draw_list;
+	uint shader;
+	ShaderWatcher shader_watcher;
+	ivec2 fb_res;
+	GpuTimer gpu_timer;
+	bool gpu_times;
+	chrono::steady_clock::time_point last_report;
+
+	// not copyable (MeshBuilder), so initialized in place
+	void init(const Options &opts, const State &state) {
+		this->mesh_source = state.mesh_source;
+		this->faces = state.faces;
+		this->fb_res = state.fb_res;
+
+		// Initialize shaders, compiled by the driver while the meshes are set up
+		const bool bindless = opts.bindless && !opts.textures.empty() && TextureSet::bindlessSupported();
+		const bool draw_parameters = opts.draw_parameters && DrawList::drawParametersSupported();
+		const std::string defines = TextureSet::defines(bindless) + DrawList::defines(draw_parameters);
+		ProgramBuild shader_build = ProgramBuild::init({ { GL_VERTEX_SHADER, "./3d.vert" }, { GL_FRAGMENT_SHADER, "./3d.frag" } }, defines);
+		this->shader_watcher = ShaderWatcher::init("./3d.vert", "./3d.frag", defines);
+
+		// Initialize buffers
+		this->va = {};
+		this->b = {};
+		allocBuffers(this->va.size(), this->va.data(), this->b.size(), this->b.data());
+		this->vao = this->va[0];
+		this->empty_vao = this->va[1];
+		this->vbo = this->b[0];
+		this->ebo = this->b[1];
+		this->ubo = this->b[2];
+		this->ssbo = this->b[3];
+		this->cmd = this->b[4];
+		this->draws = this->b[5];
+
+		glVertexArrayElementBuffer(this->vao, this->ebo);
+		// genVerts fills neither color nor uv, so compact formats leave them out
+		this->vertex_format = VertexFormat::init(opts.vertex_encoding, false, false);
+		this->vertex_format.setup(this->vao, this->vbo);
+
+		this->mesh = {};
+		this->mesh_faces = 0;
+		this->mesh_cache = {};
+		if (this->mesh_source == MESH_CPU) {
+			this->mesh_cache = MeshCache::init(opts.mesh_cache_mb << 20);
+			this->mesh_builder.start(this->vertex_format);
+			this->mesh = genVerts(&this->mesh_cache, this->vertex_format, this->faces);
+			this->mesh_faces = this->faces;
+			this->mesh.bind(this->vao, this->vertex_format.stride);
 		}
-		break;
-	case GLFW_KEY_E:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.e = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.e = false;
-			break;
+		this->gpu_mesh = {};
+		if (this->mesh_source == MESH_COMPUTE) {
+			this->gpu_mesh = GpuMesh::init(this->cmd, "./prism.comp");
+			this->gpu_mesh.generate(this->vbo, this->ebo, this->vertex_format, this->faces, state.instances);
 		}
-		break;
-	case GLFW_KEY_Q:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.q = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.q = false;
-			break;
+		if (!textureFormatSupported(opts.texture_format)) {
+			std::cout << "Failed to find GL_EXT_texture_compression_s3tc for --texture-format bc1/bc3, use bc7 or rgba8" << std::endl;
+			exit(-1);
 		}
-		break;
-	case GLFW_KEY_SPACE:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.space = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.space = false;
-			break;
+		this->texture_set = TextureSet::init(opts.textures, bindless, opts.texture_format);
+		this->texture_set.bind();
+		genInstances(this->ssbo, state.instances, this->texture_set.count);
+		this->ub_ring = UniformRing::init(this->ubo, sizeof(UniformBuffer));
+		this->draw_list = DrawList::init(this->draws, 64, draw_parameters);
+
+		this->shader = shader_build.finish();
+		if (this->shader == 0) exit(-1);
+
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_CULL_FACE);
+
+		this->gpu_timer = GpuTimer::init();
+		this->gpu_times = opts.gpu_times;
+		this->last_report = chrono::steady_clock::now();
+	}
+
+	void deinit() {
+		this->shader_watcher.deinit();
+		glDeleteProgram(this->shader);
+		if (this->mesh_source == MESH_CPU) {
+			this->mesh_builder.stop();
+			this->mesh_cache.deinit();
 		}
-		break;
-	case GLFW_KEY_LEFT_SHIFT:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.shift = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.shift = false;
-			break;
+		this->gpu_mesh.deinit();
+		this->gpu_timer.deinit();
+		this->ub_ring.deinit();
+		this->draw_list.deinit();
+		this->texture_set.deinit();
+		freeBuffers(this->va.size(), this->va.data(), this->b.size(), this->b.data());
+	}
+
+	// draws `state` (already interpolated), presenting is up to the caller
+	void frame(State state) {
+		this->shader_watcher.poll(&this->shader);
+		if (state.fb_res != this->fb_res) {
+			glViewport(0, 0, state.fb_res.x, state.fb_res.y);
+			this->fb_res = state.fb_res;
 		}
-		break;
-	case GLFW_KEY_1:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.red = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.red = false;
-			break;
+		if (state.faces != this->faces) {
+			this->faces = state.faces;
+			switch (this->mesh_source) {
+			case MESH_CPU: // keeps drawing the current mesh until the rebuild lands
+				if (const Mesh *cached = this->mesh_cache.find(this->faces)) {
+					this->mesh = *cached;
+					this->mesh_faces = this->faces;
+					this->mesh.bind(this->vao, this->vertex_format.stride);
+					this->mesh_builder.request(0);
+				} else {
+					this->mesh_builder.request(this->faces);
+				}
+				break;
+			case MESH_PROCEDURAL: // 3d.vert picks up the new count from the uniform buffer
+				break;
+			case MESH_COMPUTE:
+				this->gpu_mesh.generate(this->vbo, this->ebo, this->vertex_format, this->faces, state.instances);
+				break;
+			}
 		}
-		break;
-	case GLFW_KEY_2:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.green = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.green = false;
-			break;
+		if (this->mesh_source == MESH_CPU && this->mesh_builder.poll(&this->mesh_cache, this->mesh_faces) == this->faces) {
+			this->mesh = *this->mesh_cache.find(this->faces);
+			this->mesh_faces = this->faces;
+			this->mesh.bind(this->vao, this->vertex_format.stride);
 		}
-		break;
-	case GLFW_KEY_3:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.blue = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.blue = false;
-			break;
+		state.updateUB();
+		state.uploadUB(this->ub_ring);
+
+		{ // render
+			PROFILE_SCOPE("render");
+			this->gpu_timer.beginFrame();
+			this->gpu_timer.begin("clear");
+			glClearColor(0.0f, 0.0f, 0.0f, 1.00f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			this->gpu_timer.end();
+
+			this->gpu_timer.begin("draw");
+			switch (this->mesh_source) {
+			case MESH_CPU:
+				this->draw_list.draw(Material{ this->shader, this->vao, this->mesh.index_type }, this->mesh.command(state.instances, 0));
+				break;
+			case MESH_PROCEDURAL:
+				this->draw_list.draw(Material{ this->shader, this->empty_vao, 0 }, DrawArraysIndirectCommand{ (uint)prismTris(this->faces)*3, (uint)state.instances, 0, 0 });
+				break;
+			case MESH_COMPUTE: // prism.comp wrote the command
+				this->draw_list.drawIndirect(Material{ this->shader, this->vao, this->gpu_mesh.index_type }, this->cmd, 0, 0);
+				break;
+			}
+			this->draw_list.submit();
+			this->gpu_timer.end();
+			this->ub_ring.fence();
 		}
-		break;
-	case GLFW_KEY_TAB:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.tab = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.tab = false;
-			break;
+
+		const auto now = chrono::steady_clock::now();
+		if (this->gpu_times && now - this->last_report >= chrono::seconds(1)) {
+			this->gpu_timer.report();
+			this->last_report = now;
 		}
-		break;
 	}
-}
+};
 
-void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
-	State *state = reinterpret_cast<State*>(glfwGetWindowUserPointer(window));
-	switch (button) {
-	case GLFW_MOUSE_BUTTON_LEFT:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.left_click = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.left_click = false;
-			break;
+// what the simulation thread hands the render thread: the last two steps to interpolate between
+struct SimSnapshot {
+	State prev;
+	State state;
+	chrono::steady_clock::time_point stepped_at; // when `state` is current
+};
+
+int main(int argc, char **argv) {
+	const Options opts = parseOptions(argc, argv);
+	PROFILE_THREAD("main");
+	if (opts.bench_genverts) {
+		benchGenPrism();
+		return 0;
+	}
+	const bool headless_mode = opts.headless;
+	const int frames = opts.frames;
+
+	GLFWwindow *window = nullptr;
+	Headless headless = {};
+	State state;
+	InputQueue inputs;
+	inputs.reset();
+	if (headless_mode) {
+		headless = initHeadless(1600, 900);
+		state = State::init(headless.res);
+		state.fb_res = headless.res;
+	} else {
+		window = init();
+		ivec2 scr_res;
+		glfwGetWindowSize(window, &scr_res.x, &scr_res.y);
+		state = State::init(scr_res);
+		glfwGetFramebufferSize(window, &state.fb_res.x, &state.fb_res.y);
+		glfwGetCursorPos(window, &state.mouse.last_xpos, &state.mouse.last_ypos);
+		glfwSetWindowUserPointer(window, reinterpret_cast<void *>(&inputs));
+		glfwSetKeyCallback(window, keyCallback);
+		glfwSetMouseButtonCallback(window, mouseButtonCallback);
+		glfwSetCursorPosCallback(window, cursorPosCallback);
+		glfwSetScrollCallback(window, scrollCallback);
+		glfwSetWindowSizeCallback(window, windowSizeCallback);
+		glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
+	state.faces = opts.faces;
+	state.instances = opts.instances;
+	state.mesh_source = opts.mesh_source;
+
+	Renderer renderer;
+	renderer.init(opts, state);
+
+	// The simulation advances in fixed SIM_STEP_MS steps however long frames take, and rendering
+	// interpolates between the last two steps, so motion is smooth and identical at any frame rate.
+	if (headless_mode) {
+		// single threaded, with a fixed 60 Hz frame time so every run animates identically
+		std::vector<double> frame_ms;
+		frame_ms.reserve(frames);
+		State prev_state = state;
+		double sim_accumulator_ms = 0.0;
+		for (int frame = 0; frame < frames; frame++) {
+			PROFILE_SCOPE("frame");
+			const auto start = chrono::steady_clock::now();
+			{ // process
+				PROFILE_SCOPE("process");
+				state.scriptFrame(frame, frames);
+				sim_accumulator_ms += 1000.0/60.0;
+				while (sim_accumulator_ms >= SIM_STEP_MS) {
+					prev_state = state;
+					state.step(SIM_STEP_MS);
+					sim_accumulator_ms -= SIM_STEP_MS;
+				}
+			}
+			renderer.frame(state.interpolate(prev_state, sim_accumulator_ms / SIM_STEP_MS));
+			{
+				PROFILE_SCOPE("glFinish");
+				glFinish();
+			}
+			frame_ms.push_back(chrono::duration<double, std::milli>(chrono::steady_clock::now() - start).count());
 		}
-		break;
-	case GLFW_MOUSE_BUTTON_RIGHT:
-		switch (action) {
-		case GLFW_PRESS:
-			state->keys.right_click = true;
-			break;
-		case GLFW_RELEASE:
-			state->keys.right_click = false;
-			break;
+		if (opts.dump != nullptr) dumpFramebuffer(opts.dump, headless.res);
+		printFrameStats(frame_ms, prismTris(state.faces) * state.instances);
+		renderer.gpu_timer.flush(); // the last frames' queries haven't come round again
+		renderer.gpu_timer.report();
+	} else {
+		// This thread handles GLFW events (GLFW only allows that on the main thread), a simulation
+		// thread steps a private State, and a render thread owns the GL context. Input goes through
+		// an SPSC event queue and snapshots through a triple buffer, both lock-free, so a slow step
+		// or a slow GPU frame never holds up the other two.
+		std::atomic<bool> running = true;
+		TripleBuffer<SimSnapshot> snapshots;
+		snapshots.reset(SimSnapshot{ .prev = state, .state = state, .stepped_at = chrono::steady_clock::now() });
+
+		std::thread sim_thread([&running, &inputs, &snapshots, sim_state = state]() mutable {
+			PROFILE_THREAD("simulation");
+			const auto sim_step = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, std::milli>(SIM_STEP_MS));
+			const auto max_lag = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, std::milli>(MAX_LAG_MS));
+			auto step_end = chrono::steady_clock::now();
+			while (running.load(std::memory_order_relaxed)) {
+				step_end += sim_step;
+				// after a stall (breakpoint, suspend) skip ahead instead of running hundreds of steps
+				const auto now = chrono::steady_clock::now();
+				if (now - step_end > max_lag) step_end = now;
+				std::this_thread::sleep_until(step_end);
+
+				PROFILE_SCOPE("process");
+				SimSnapshot &snapshot = snapshots.write();
+				snapshot.prev = sim_state;
+				sim_state.stepEvents(SIM_STEP_MS, step_end, &inputs);
+				snapshot.state = sim_state;
+				snapshot.stepped_at = step_end;
+				snapshots.publish();
+			}
+		});
+
+		glfwMakeContextCurrent(nullptr);
+		std::thread render_thread([&running, &snapshots, &renderer, window] {
+			PROFILE_THREAD("render");
+			glfwMakeContextCurrent(window);
+			while (running.load(std::memory_order_relaxed)) {
+				PROFILE_SCOPE("frame");
+				snapshots.update();
+				const SimSnapshot &snapshot = snapshots.read();
+				// render one step behind the simulation so there is always a later step to blend towards
+				const double since_ms = chrono::duration<double, std::milli>(chrono::steady_clock::now() - snapshot.stepped_at).count();
+				const float alpha = std::clamp(since_ms / SIM_STEP_MS, 0.0, 1.0);
+				renderer.frame(snapshot.state.interpolate(snapshot.prev, alpha));
+				PROFILE_SCOPE("glfwSwapBuffers");
+				glfwSwapBuffers(window);
+			}
+			glfwMakeContextCurrent(nullptr);
+		});
+
+		while (!glfwWindowShouldClose(window)) {
+			PROFILE_SCOPE("glfwWaitEvents");
+			glfwWaitEvents();
+		}
+		running.store(false, std::memory_order_relaxed);
+		sim_thread.join();
+		render_thread.join();
+		glfwMakeContextCurrent(window);
+	}
+
+	renderer.deinit();
+	if (opts.trace != nullptr) profileDump(opts.trace); // after every other thread is joined
+	if (headless_mode) {
+		deinitHeadless(&headless);
+	} else {
+		deinit(&window);
+	}
+	return 0;
+}
+
+Options parseOptions(int argc, char **argv) {
+	Options opts = {
+		.headless = false,
+		.frames = 1000,
+		.faces = 4,
+		.instances = 1,
+		.vertex_encoding = VERTEX_HALF,
+		.mesh_source = MESH_CPU,
+		.dump = nullptr,
+		.bench_genverts = false,
+		.mesh_cache_mb = 64,
+		.gpu_times = false,
+		.trace = nullptr,
+		.textures = {},
+		.texture_format = TEXTURE_RGBA8,
+		.bindless = true,
+		.draw_parameters = true,
+	};
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--headless") == 0) {
+			opts.headless = true;
+		} else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			opts.frames = std::max(1, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--faces") == 0 && i + 1 < argc) {
+			opts.faces = std::max(3, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+			opts.instances = std::max(1, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--procedural") == 0) {
+			opts.mesh_source = MESH_PROCEDURAL;
+		} else if (std::strcmp(argv[i], "--compute") == 0) {
+			opts.mesh_source = MESH_COMPUTE;
+		} else if (std::strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+			opts.dump = argv[++i];
+		} else if (std::strcmp(argv[i], "--mesh-cache-mb") == 0 && i + 1 < argc) {
+			opts.mesh_cache_mb = std::max(0, std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			opts.trace = argv[++i];
+		} else if (std::strcmp(argv[i], "--texture") == 0 && i + 1 < argc) {
+			opts.textures.push_back(argv[++i]);
+		} else if (std::strcmp(argv[i], "--texture-format") == 0 && i + 1 < argc) {
+			const char *const name = argv[++i];
+			if (!parseTextureFormat(name, &opts.texture_format)) {
+				std::cout << "Unknown texture format " << name << std::endl;
+				exit(-1);
+			}
+		} else if (std::strcmp(argv[i], "--no-bindless") == 0) {
+			opts.bindless = false;
+		} else if (std::strcmp(argv[i], "--no-draw-parameters") == 0) {
+			opts.draw_parameters = false;
+		} else if (std::strcmp(argv[i], "--gpu-times") == 0) {
+			opts.gpu_times = true;
+		} else if (std::strcmp(argv[i], "--bench-genverts") == 0) {
+			opts.bench_genverts = true;
+		} else if (std::strcmp(argv[i], "--vertex-format") == 0 && i + 1 < argc) {
+			i++;
+			if (std::strcmp(argv[i], "full") == 0) opts.vertex_encoding = VERTEX_FULL;
+			else if (std::strcmp(argv[i], "half") == 0) opts.vertex_encoding = VERTEX_HALF;
+			else if (std::strcmp(argv[i], "snorm") == 0) opts.vertex_encoding = VERTEX_SNORM;
+			else {
+				std::cout << "unknown vertex format: " << argv[i] << std::endl;
+				exit(-1);
+			}
+		} else {
+			std::cout << "usage: " << argv[0] << " [--headless] [--frames N] [--faces N] [--instances N] [--vertex-format full|half|snorm] [--procedural | --compute] [--dump FILE.ppm] [--mesh-cache-mb N] [--texture FILE]... [--texture-format rgba8|bc1|bc3|bc7] [--no-bindless] [--no-draw-parameters] [--gpu-times] [--trace FILE.json] [--bench-genverts]" << std::endl;
+			exit(-1);
 		}
-		break;
 	}
+	return opts;
+}
+
+// The callbacks only timestamp and queue events (wait-free), State::applyEvent interprets them.
+// A full queue drops the event rather than stall input handling.
+void pushInputEvent(GLFWwindow* window, InputType type, int code, int action, double x, double y) {
+	InputQueue *inputs = reinterpret_cast<InputQueue*>(glfwGetWindowUserPointer(window));
+	inputs->push(InputEvent{
+		.type = type,
+		.code = code,
+		.action = action,
+		.x = x,
+		.y = y,
+		.time = chrono::steady_clock::now(),
+	});
+}
+
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	pushInputEvent(window, INPUT_KEY, key, action, 0.0, 0.0);
+}
+
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+	pushInputEvent(window, INPUT_MOUSE_BUTTON, button, action, 0.0, 0.0);
 }
 
 void cursorPosCallback(GLFWwindow* window, double xpos, double ypos) {
-	State *state = reinterpret_cast<State*>(glfwGetWindowUserPointer(window));
-	double xoffset =  (xpos - state->mouse.last_xpos) * state->mouse.sens;
-	double yoffset = -(ypos - state->mouse.last_ypos) * state->mouse.sens;
-	state->mouse.last_xpos = xpos;
-	state->mouse.last_ypos = ypos;
-
-	state->mouse.yaw = state->mouse.yaw + xoffset;
-	state->mouse.pitch = std::clamp(state->mouse.pitch + yoffset, -89.0d, 89.0d);
-	state->view.front = glm::normalize(vec3(
-		std::cos(glm::radians(state->mouse.yaw)) * std::cos(glm::radians(state->mouse.pitch)),
-		std::sin(glm::radians(state->mouse.pitch)),
-		std::sin(glm::radians(state->mouse.yaw)) * std::cos(glm::radians(state->mouse.pitch))
-	));
+	pushInputEvent(window, INPUT_CURSOR, 0, 0, xpos, ypos);
 }
 
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
-	State *state = reinterpret_cast<State*>(glfwGetWindowUserPointer(window));
 }
 
 void windowSizeCallback(GLFWwindow* window, int width, int height) {
-	State *state = reinterpret_cast<State*>(glfwGetWindowUserPointer(window));
-	state->scr_res = ivec2(width, height);
+	pushInputEvent(window, INPUT_WINDOW_SIZE, 0, 0, width, height);
 }
 
-std::vector<Vertex> genVerts(uint vbo, int faces) {
-	std::vector<Vertex> vertices;
-	vertices.reserve(faces*6 + (faces-2)*3*2);
-
-	const float pi = M_PI;
-	const float radius = 1.0f;
-	const float height = 1.0f;
-	const float bot = 0.0f - height/2.0f;
-	const float top = 0.0f + height/2.0f;
-	for (int i = 0; i < faces; i++) { // side
-		// in (x, z)
-		const vec2 left  = radius * vec2(std::sin((float)    i/(float)faces * 2.0f*pi), std::cos((float)    i/(float)faces * 2.0f*pi));
-		const vec2 right = radius * vec2(std::sin((float)(i+1)/(float)faces * 2.0f*pi), std::cos((float)(i+1)/(float)faces * 2.0f*pi));
-		const vec3 norm = glm::normalize(glm::cross(
-			vec3(left.x,  top, left.y) - vec3(right.x, top, right.y),
-                        vec3(left.x,  bot, left.y) - vec3(left.x,  top, left.y)
-		));
-		vertices.push_back(Vertex{ .pos = vec3(right.x, top, right.y), .norm = norm });
-		vertices.push_back(Vertex{ .pos = vec3(left.x,  top, left.y),  .norm = norm });
-		vertices.push_back(Vertex{ .pos = vec3(left.x,  bot, left.y),  .norm = norm });
-		vertices.push_back(Vertex{ .pos = vec3(left.x,  bot, left.y),  .norm = norm });
-		vertices.push_back(Vertex{ .pos = vec3(right.x, bot, right.y), .norm = norm });
-		vertices.push_back(Vertex{ .pos = vec3(right.x, top, right.y), .norm = norm });
-	}
-	// in (x, z)
-	const vec2 origin = radius * vec2(std::sin(0.0f/(float)faces * 2.0f*pi), std::cos(0.0f/(float)faces * 2.0f*pi));
-	for (int i = 1; i < faces - 1; i++) { // top
-		// in (x, z)
-		const vec2 left  = radius * vec2(std::sin((float)    i/(float)faces * 2.0f*pi), std::cos((float)    i/(float)faces * 2.0f*pi));
-		const vec2 right = radius * vec2(std::sin((float)(i+1)/(float)faces * 2.0f*pi), std::cos((float)(i+1)/(float)faces * 2.0f*pi));
-		const vec3 norm = vec3(0.0f, 1.0f, 0.0f);
-		vertices.push_back(Vertex{ .pos = vec3(origin.x, top, origin.y), .norm = norm });
-		vertices.push_back(Vertex{ .pos = vec3(left.x,   top, left.y),  .norm = norm });
-		vertices.push_back(Vertex{ .pos = vec3(right.x,  top, right.y),  .norm = norm });
-	}
-	for (int i = 0; i < faces - 1; i++) { // bot
-		// in (x, z)
-		const vec2 left  = radius * vec2(std::sin((float)    i/(float)faces * 2.0f*pi), std::cos((float)    i/(float)faces * 2.0f*pi));
-		const vec2 right = radius * vec2(std::sin((float)(i+1)/(float)faces * 2.0f*pi), std::cos((float)(i+1)/(float)faces * 2.0f*pi));
-		const vec3 norm = vec3(0.0f, -1.0f, 0.0f);
-		vertices.push_back(Vertex{ .pos = vec3(origin.x, bot, origin.y), .norm = norm });
-		vertices.push_back(Vertex{ .pos = vec3(right.x,  bot, right.y),  .norm = norm });
-		vertices.push_back(Vertex{ .pos = vec3(left.x,   bot, left.y),  .norm = norm });
-	}
+// the GL context lives on the render thread, which sets the viewport from State::fb_res
+void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
+	pushInputEvent(window, INPUT_FRAMEBUFFER_SIZE, 0, 0, width, height);
+}
+
+// synchronous counterpart of MeshBuilder, used for the first mesh
+Mesh genVerts(MeshCache *const cache, const VertexFormat &fmt, int faces) {
+	PROFILE_SCOPE("genVerts");
+	Mesh mesh = genPrism(faces);
+	const usize vbo_size = fmt.stride * mesh.vertices.size();
+	const GLenum index_type = Mesh::indexType(mesh.vertices.size());
+	const usize ebo_size = Mesh::indexSize(index_type) * mesh.indices.size();
+	const Mesh ranges = cache->insert(faces, vbo_size, ebo_size, index_type, mesh.indices.size(), 0);
+	mesh.index_type = ranges.index_type;
+	mesh.index_count = ranges.index_count;
+	mesh.buffer = ranges.buffer;
+	mesh.vertex_offset = ranges.vertex_offset;
+	mesh.index_offset = ranges.index_offset;
 
 	// std::cout << "faces: " << faces << std::endl;
-	// std::cout << "verts: " << vertices.size() << std::endl;
-	// for (auto v : vertices) {
+	// std::cout << "verts: " << mesh.vertices.size() << std::endl;
+	// std::cout << "indices: " << mesh.indices.size() << std::endl;
+	// for (auto v : mesh.vertices) {
 	// 	std::cout << glm::to_string(v.pos) << " " << glm::to_string(v.norm) << std::endl;
 	// }
 
-	glNamedBufferData(vbo, sizeof(Vertex)*vertices.size(), vertices.data(), GL_STATIC_DRAW);
-	return vertices;
+	mesh.upload(fmt);
+	return ranges;
+}
+
+// One instance is the original sculpture. More are laid out on a cube grid that fits in the
+// same volume, each with its own color and spin.
+void genInstances(uint ssbo, int count, int textures) {
+	std::vector<Instance> instances;
+	instances.reserve(count);
+	if (count == 1) {
+		instances.push_back(Instance{
+			.offset_scale = vec4(0.0f, 0.0f, 0.0f, 1.0f),
+			.clr = vec4(1.0f),
+			.spin = vec2(0.0f),
+			.tex = textures > 0 ? 0 : -1,
+		});
+	} else {
+		const int side = std::ceil(std::cbrt((float)count));
+		const float cell = 2.0f / (float)side;
+		for (int i = 0; i < count; i++) {
+			const vec3 grid = vec3(i % side, (i / side) % side, i / (side*side));
+			const vec3 t = (grid + 0.5f) / (float)side;
+			instances.push_back(Instance{
+				.offset_scale = vec4(t * 2.0f - 1.0f, 0.35f * cell),
+				.clr = vec4(0.3f + 0.7f * t, 1.0f),
+				.spin = vec2(360.0f * t.x, 4.0f * (t.z - 0.5f)),
+				.tex = textures > 0 ? i % textures : -1,
+			});
+		}
+	}
+	glNamedBufferData(ssbo, sizeof(Instance)*instances.size(), instances.data(), GL_STATIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ssbo);
 }
@@ -0,0 +1,144 @@
+#pragma once
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Rebuilds the CPU mesh on a worker thread when the face count changes.
+// The worker packs vertices and indices straight into a persistently mapped staging buffer, and
+// the GL thread later copies them into ranges of the MeshCache on the GPU. Until then the
+// renderer keeps drawing the previous mesh, so a rebuild never stalls the frame loop.
+struct MeshBuilder {
+	struct Job {
+		int faces;
+		GLenum index_type;
+		usize index_count;
+		usize vbo_size;
+		usize ebo_offset; // into staging
+		usize ebo_size;
+	};
+
+	VertexFormat fmt;
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable cv;
+	// guarded by mutex
+	bool quit;
+	bool busy;
+	bool done;
+	Job job;
+
+	// GL thread only
+	int pending_faces; // requested but not started yet, 0 if none
+	uint staging;
+	uchar *staging_ptr;
+	usize staging_capacity;
+	GLsync copy_fence; // last copy out of staging
+
+	// not copyable (thread, mutex), so initialized in place
+	void start(const VertexFormat &fmt) {
+		this->fmt = fmt;
+		this->quit = false;
+		this->busy = false;
+		this->done = false;
+		this->pending_faces = 0;
+		this->staging = 0;
+		this->staging_ptr = nullptr;
+		this->staging_capacity = 0;
+		this->copy_fence = nullptr;
+		this->worker = std::thread(&MeshBuilder::run, this);
+	}
+
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->quit = true;
+		}
+		this->cv.notify_one();
+		this->worker.join();
+		if (this->copy_fence != nullptr) glDeleteSync(this->copy_fence);
+		if (this->staging != 0) glDeleteBuffers(1, &this->staging);
+		this->copy_fence = nullptr;
+		this->staging = 0;
+	}
+
+	// latest request wins if several arrive while the worker is busy, 0 cancels
+	void request(int faces) {
+		this->pending_faces = faces;
+	}
+
+	// Call once per frame on the GL thread. Returns the face count that just landed in `cache`,
+	// or 0. `pinned` is the face count on screen, which must not be evicted.
+	int poll(MeshCache *const cache, int pinned) {
+		PROFILE_SCOPE("mesh poll");
+		// staging may only be written again after the GPU finished copying out of it
+		if (this->copy_fence != nullptr) {
+			if (glClientWaitSync(this->copy_fence, 0, 0) == GL_TIMEOUT_EXPIRED) return 0;
+			glDeleteSync(this->copy_fence);
+			this->copy_fence = nullptr;
+		}
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+		if (this->busy) return 0;
+		if (this->done) {
+			const Job &job = this->job;
+			const Mesh dst = cache->insert(job.faces, job.vbo_size, job.ebo_size, job.index_type, job.index_count, pinned);
+			glCopyNamedBufferSubData(this->staging, dst.buffer, 0, dst.vertex_offset, job.vbo_size);
+			glCopyNamedBufferSubData(this->staging, dst.buffer, job.ebo_offset, dst.index_offset, job.ebo_size);
+			this->copy_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			this->done = false;
+			return job.faces;
+		}
+		if (this->pending_faces == 0) return 0;
+
+		Job job = {};
+		job.faces = this->pending_faces;
+		const usize vertex_count = job.faces*6;
+		job.index_type = Mesh::indexType(vertex_count);
+		job.index_count = prismTris(job.faces)*3;
+		job.vbo_size = this->fmt.stride * vertex_count;
+		job.ebo_offset = (job.vbo_size + 3) / 4 * 4;
+		job.ebo_size = Mesh::indexSize(job.index_type) * job.index_count;
+		this->reserveStaging(job.ebo_offset + job.ebo_size);
+
+		this->pending_faces = 0;
+		this->job = job;
+		this->busy = true;
+		lock.unlock();
+		this->cv.notify_one();
+		return 0;
+	}
+
+	// only called while no job runs and no copy is in flight
+	void reserveStaging(usize size) {
+		if (size <= this->staging_capacity) return;
+		if (this->staging != 0) glDeleteBuffers(1, &this->staging);
+		// grow geometrically so stepping through face counts doesn't reallocate every time
+		this->staging_capacity = std::max(size, this->staging_capacity * 2);
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &this->staging);
+		glNamedBufferStorage(this->staging, this->staging_capacity, nullptr, flags);
+		this->staging_ptr = reinterpret_cast<uchar*>(glMapNamedBufferRange(this->staging, 0, this->staging_capacity, flags));
+	}
+
+	void run() {
+		PROFILE_THREAD("mesh builder");
+		std::unique_lock<std::mutex> lock(this->mutex);
+		while (true) {
+			this->cv.wait(lock, [this] { return this->quit || this->busy; });
+			if (this->quit) return;
+			const Job job = this->job;
+			uchar *const staging_ptr = this->staging_ptr;
+			lock.unlock();
+
+			PROFILE_SCOPE("build mesh");
+			Mesh mesh = genPrism(job.faces);
+			mesh.index_type = job.index_type;
+			this->fmt.packInto(mesh.vertices, staging_ptr);
+			mesh.writeIndices(staging_ptr + job.ebo_offset);
+
+			lock.lock();
+			this->busy = false;
+			this->done = true;
+		}
+	}
+};
@@ -0,0 +1,127 @@
+#pragma once
+#include <list>
+#include <map>
+#include <unordered_map>
+
+// GPU meshes keyed by face count, suballocated from one arena buffer of `budget` bytes with LRU
+// eviction, so flicking back to a face count that was built before is just a rebind.
+// A mesh that can't fit in the arena gets a dedicated buffer instead, and at most one of those
+// is kept besides the one on screen.
+struct MeshCache {
+	static constexpr usize alignment = 16;
+
+	struct Entry {
+		Mesh mesh; // buffer ranges only, no CPU-side arrays
+		usize offset;
+		usize size;
+		std::list<int>::iterator lru;
+	};
+
+	uint arena;
+	usize budget;
+	std::map<usize, usize> free_blocks; // offset -> size, coalesced
+	std::unordered_map<int, Entry> entries;
+	std::list<int> lru; // most recently used first
+
+	static MeshCache init(usize budget) {
+		MeshCache cache = {};
+		cache.budget = std::max(budget, alignment);
+		glCreateBuffers(1, &cache.arena);
+		glNamedBufferStorage(cache.arena, cache.budget, nullptr, GL_DYNAMIC_STORAGE_BIT);
+		cache.free_blocks[0] = cache.budget;
+		return cache;
+	}
+
+	void deinit() {
+		while (!this->lru.empty()) this->evict(this->lru.back());
+		glDeleteBuffers(1, &this->arena);
+		this->arena = 0;
+	}
+
+	const Mesh *find(int faces) {
+		auto it = this->entries.find(faces);
+		if (it == this->entries.end()) return nullptr;
+		this->lru.splice(this->lru.begin(), this->lru, it->second.lru);
+		return &it->second.mesh;
+	}
+
+	// Reserves ranges for a new mesh and returns it with `buffer` and the offsets filled in; the caller
+	// writes the data. Evicts least recently used meshes as needed, but never `pinned` (the one on screen).
+	Mesh insert(int faces, usize vbo_size, usize ebo_size, GLenum index_type, usize index_count, int pinned) {
+		// a rebuild of a cached count produces the same bytes, so it can overwrite them in place
+		if (const Mesh *cached = this->find(faces)) return *cached;
+
+		Mesh mesh = {};
+		mesh.index_type = index_type;
+		mesh.index_count = index_count;
+		const usize ebo_offset = (vbo_size + 3) / 4 * 4;
+		const usize size = (ebo_offset + ebo_size + alignment - 1) / alignment * alignment;
+
+		usize offset = 0;
+		bool fits = size <= this->budget && this->allocate(size, &offset);
+		while (!fits && size <= this->budget) {
+			auto victim = std::find_if(this->lru.rbegin(), this->lru.rend(), [pinned](int f) { return f != pinned; });
+			if (victim == this->lru.rend()) break;
+			this->evict(*victim);
+			fits = this->allocate(size, &offset);
+		}
+
+		if (fits) {
+			mesh.buffer = this->arena;
+		} else {
+			for (auto it = this->lru.begin(); it != this->lru.end();) {
+				const int f = *it++;
+				if (f != pinned && this->entries[f].mesh.buffer != this->arena) this->evict(f);
+			}
+			glCreateBuffers(1, &mesh.buffer);
+			glNamedBufferStorage(mesh.buffer, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+			offset = 0;
+		}
+		mesh.vertex_offset = offset;
+		mesh.index_offset = offset + ebo_offset;
+		this->lru.push_front(faces);
+		this->entries[faces] = Entry{ .mesh = mesh, .offset = offset, .size = size, .lru = this->lru.begin() };
+		return mesh;
+	}
+
+	void evict(int faces) {
+		auto it = this->entries.find(faces);
+		const Entry &entry = it->second;
+		if (entry.mesh.buffer == this->arena) {
+			this->release(entry.offset, entry.size);
+		} else {
+			glDeleteBuffers(1, &entry.mesh.buffer);
+		}
+		this->lru.erase(entry.lru);
+		this->entries.erase(it);
+	}
+
+	// first fit
+	bool allocate(usize size, usize *const offset) {
+		for (auto it = this->free_blocks.begin(); it != this->free_blocks.end(); it++) {
+			if (it->second < size) continue;
+			*offset = it->first;
+			const usize rest = it->second - size;
+			this->free_blocks.erase(it);
+			if (rest > 0) this->free_blocks[*offset + size] = rest;
+			return true;
+		}
+		return false;
+	}
+
+	void release(usize offset, usize size) {
+		auto next = this->free_blocks.lower_bound(offset);
+		if (next != this->free_blocks.end() && offset + size == next->first) {
+			size += next->second;
+			next = this->free_blocks.erase(next);
+		}
+		if (next != this->free_blocks.begin()) {
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset) {
+				prev->second += size;
+				return;
+			}
+		}
+		this->free_blocks[offset] = size;
+	}
+};
@@ -0,0 +1,231 @@
+#pragma once
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+const float PRISM_RADIUS = 1.0f;
+const float PRISM_HEIGHT = 1.0f;
+
+// same for genPrism, prism.comp and the procedural path in 3d.vert
+usize prismTris(int faces) {
+	return faces*2 + (faces-2)*2;
+}
+
+// sin/cos of i/n * 2pi for every i in [0, n).
+// Reduces by pi/2 in two parts, then uses the Cephes sinf/cosf minimax polynomials on
+// [-pi/4, pi/4] (~1 ulp) and fixes up the quadrant. The SIMD paths do the exact same float
+// operations as the scalar tail, so results don't depend on which path ran.
+namespace sincos_detail {
+	const float two_over_pi = 0.636619772f;
+	const float pio2_hi = 1.57079637f;
+	const float pio2_lo = -4.37113883e-8f;
+	const float s1 = -1.6666654611e-1f, s2 = 8.3321608736e-3f, s3 = -1.9515295891e-4f;
+	const float c1 = 4.166664568298827e-2f, c2 = -1.388731625493765e-3f, c3 = 2.443315711809948e-5f;
+
+	void scalar(float x, float *const s_out, float *const c_out) {
+		const int q = (int)std::nearbyint(x * two_over_pi);
+		const float r = (x - (float)q * pio2_hi) - (float)q * pio2_lo;
+		const float r2 = r * r;
+		const float s = r + r * r2 * (s1 + r2 * (s2 + r2 * s3));
+		const float c = 1.0f - 0.5f * r2 + r2 * r2 * (c1 + r2 * (c2 + r2 * c3));
+		float sin_x = (q & 1) ? c : s;
+		float cos_x = (q & 1) ? s : c;
+		if (q & 2) sin_x = -sin_x;
+		if ((q + 1) & 2) cos_x = -cos_x;
+		*s_out = sin_x;
+		*c_out = cos_x;
+	}
+}
+
+void ringSinCos(int n, float *const sin_out, float *const cos_out) {
+	using namespace sincos_detail;
+	const float step = 2.0f*(float)M_PI / (float)n;
+	int i = 0;
+#if defined(__AVX2__)
+	const __m256 v_step = _mm256_set1_ps(step);
+	for (; i + 8 <= n; i += 8) {
+		const __m256 x = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))), v_step);
+		const __m256i q = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(two_over_pi)));
+		const __m256 qf = _mm256_cvtepi32_ps(q);
+		const __m256 r = _mm256_sub_ps(_mm256_sub_ps(x, _mm256_mul_ps(qf, _mm256_set1_ps(pio2_hi))), _mm256_mul_ps(qf, _mm256_set1_ps(pio2_lo)));
+		const __m256 r2 = _mm256_mul_ps(r, r);
+		__m256 ps = _mm256_add_ps(_mm256_set1_ps(s2), _mm256_mul_ps(r2, _mm256_set1_ps(s3)));
+		ps = _mm256_add_ps(_mm256_set1_ps(s1), _mm256_mul_ps(r2, ps));
+		const __m256 s = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, r2), ps));
+		__m256 pc = _mm256_add_ps(_mm256_set1_ps(c2), _mm256_mul_ps(r2, _mm256_set1_ps(c3)));
+		pc = _mm256_add_ps(_mm256_set1_ps(c1), _mm256_mul_ps(r2, pc));
+		const __m256 c = _mm256_add_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_set1_ps(0.5f), r2)), _mm256_mul_ps(_mm256_mul_ps(r2, r2), pc));
+		const __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+		const __m256 sin_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(2)), 30));
+		const __m256 cos_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+		_mm256_storeu_ps(sin_out + i, _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sin_sign));
+		_mm256_storeu_ps(cos_out + i, _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cos_sign));
+	}
+#elif defined(__SSE2__)
+	const __m128 v_step = _mm_set1_ps(step);
+	for (; i + 4 <= n; i += 4) {
+		const __m128 x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(i), _mm_setr_epi32(0, 1, 2, 3))), v_step);
+		const __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(two_over_pi)));
+		const __m128 qf = _mm_cvtepi32_ps(q);
+		const __m128 r = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(pio2_hi))), _mm_mul_ps(qf, _mm_set1_ps(pio2_lo)));
+		const __m128 r2 = _mm_mul_ps(r, r);
+		__m128 ps = _mm_add_ps(_mm_set1_ps(s2), _mm_mul_ps(r2, _mm_set1_ps(s3)));
+		ps = _mm_add_ps(_mm_set1_ps(s1), _mm_mul_ps(r2, ps));
+		const __m128 s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), ps));
+		__m128 pc = _mm_add_ps(_mm_set1_ps(c2), _mm_mul_ps(r2, _mm_set1_ps(c3)));
+		pc = _mm_add_ps(_mm_set1_ps(c1), _mm_mul_ps(r2, pc));
+		const __m128 c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_mul_ps(_mm_mul_ps(r2, r2), pc));
+		// no blendv in SSE2
+		const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+		const __m128 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+		const __m128 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+		const __m128 sin_x = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+		const __m128 cos_x = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+		_mm_storeu_ps(sin_out + i, _mm_xor_ps(sin_x, sin_sign));
+		_mm_storeu_ps(cos_out + i, _mm_xor_ps(cos_x, cos_sign));
+	}
+#endif
+	for (; i < n; i++) {
+		scalar((float)i * step, sin_out + i, cos_out + i);
+	}
+}
+
+// Rim computed once, side and cap geometry assembled from it. Same layout as genPrismReference.
+Mesh genPrism(int faces) {
+	Mesh mesh = {};
+	mesh.vertices.resize(faces*4 + faces*2);
+	mesh.indices.resize(prismTris(faces)*3);
+
+	// rim[i] in (x, z); rim[faces] closes the loop exactly
+	std::vector<float> rim_x(faces + 1), rim_z(faces + 1);
+	ringSinCos(faces, rim_x.data(), rim_z.data());
+	rim_x[faces] = rim_x[0];
+	rim_z[faces] = rim_z[0];
+
+	const float bot = 0.0f - PRISM_HEIGHT/2.0f;
+	const float top = 0.0f + PRISM_HEIGHT/2.0f;
+	Vertex *v = mesh.vertices.data();
+	uint *idx = mesh.indices.data();
+	for (int i = 0; i < faces; i++) { // side
+		const vec2 left  = PRISM_RADIUS * vec2(rim_x[i],   rim_z[i]);
+		const vec2 right = PRISM_RADIUS * vec2(rim_x[i+1], rim_z[i+1]);
+		// cross(top_left - top_right, bot_left - top_left) with the height factored out
+		const vec3 norm = glm::normalize(vec3(left.y - right.y, 0.0f, right.x - left.x));
+		// flat shaded, so each face keeps its own 4 corners
+		const uint base = i*4;
+		v[base+0] = Vertex{ .pos = vec3(right.x, top, right.y), .norm = norm };
+		v[base+1] = Vertex{ .pos = vec3(left.x,  top, left.y),  .norm = norm };
+		v[base+2] = Vertex{ .pos = vec3(left.x,  bot, left.y),  .norm = norm };
+		v[base+3] = Vertex{ .pos = vec3(right.x, bot, right.y), .norm = norm };
+		uint *const out = idx + i*6;
+		out[0] = base+0; out[1] = base+1; out[2] = base+2;
+		out[3] = base+2; out[4] = base+3; out[5] = base+0;
+	}
+	// caps share one rim per face count, fanned out from the first rim vertex
+	const uint top_base = faces*4;
+	const uint bot_base = faces*5;
+	for (int i = 0; i < faces; i++) { // rims
+		const vec2 p = PRISM_RADIUS * vec2(rim_x[i], rim_z[i]);
+		v[top_base+i] = Vertex{ .pos = vec3(p.x, top, p.y), .norm = vec3(0.0f, 1.0f, 0.0f) };
+		v[bot_base+i] = Vertex{ .pos = vec3(p.x, bot, p.y), .norm = vec3(0.0f, -1.0f, 0.0f) };
+	}
+	uint *out = idx + faces*6;
+	for (uint i = 1; i + 1 < (uint)faces; i++, out += 3) { // top
+		out[0] = top_base; out[1] = top_base+i; out[2] = top_base+i+1;
+	}
+	for (uint i = 1; i + 1 < (uint)faces; i++, out += 3) { // bot
+		out[0] = bot_base; out[1] = bot_base+i+1; out[2] = bot_base+i;
+	}
+	return mesh;
+}
+
+// Straightforward per-face std::sin/std::cos version genPrism replaced, kept for --bench-genverts.
+Mesh genPrismReference(int faces) {
+	Mesh mesh = {};
+	mesh.vertices.reserve(faces*4 + faces*2);
+	mesh.indices.reserve(faces*6 + (faces-2)*3*2);
+
+	const float pi = M_PI;
+	const float radius = 1.0f;
+	const float height = 1.0f;
+	const float bot = 0.0f - height/2.0f;
+	const float top = 0.0f + height/2.0f;
+	for (int i = 0; i < faces; i++) { // side
+		// in (x, z)
+		const vec2 left  = radius * vec2(std::sin((float)    i/(float)faces * 2.0f*pi), std::cos((float)    i/(float)faces * 2.0f*pi));
+		const vec2 right = radius * vec2(std::sin((float)(i+1)/(float)faces * 2.0f*pi), std::cos((float)(i+1)/(float)faces * 2.0f*pi));
+		const vec3 norm = glm::normalize(glm::cross(
+			vec3(left.x,  top, left.y) - vec3(right.x, top, right.y),
+                        vec3(left.x,  bot, left.y) - vec3(left.x,  top, left.y)
+		));
+		// flat shaded, so each face keeps its own 4 corners
+		const uint base = mesh.vertices.size();
+		mesh.vertices.push_back(Vertex{ .pos = vec3(right.x, top, right.y), .norm = norm });
+		mesh.vertices.push_back(Vertex{ .pos = vec3(left.x,  top, left.y),  .norm = norm });
+		mesh.vertices.push_back(Vertex{ .pos = vec3(left.x,  bot, left.y),  .norm = norm });
+		mesh.vertices.push_back(Vertex{ .pos = vec3(right.x, bot, right.y), .norm = norm });
+		mesh.indices.insert(mesh.indices.end(), { base+0, base+1, base+2, base+2, base+3, base+0 });
+	}
+	// caps share one rim per face count, fanned out from the first rim vertex
+	const uint top_base = mesh.vertices.size();
+	for (int i = 0; i < faces; i++) { // top rim
+		// in (x, z)
+		const vec2 p = radius * vec2(std::sin((float)i/(float)faces * 2.0f*pi), std::cos((float)i/(float)faces * 2.0f*pi));
+		mesh.vertices.push_back(Vertex{ .pos = vec3(p.x, top, p.y), .norm = vec3(0.0f, 1.0f, 0.0f) });
+	}
+	const uint bot_base = mesh.vertices.size();
+	for (int i = 0; i < faces; i++) { // bot rim
+		// in (x, z)
+		const vec2 p = radius * vec2(std::sin((float)i/(float)faces * 2.0f*pi), std::cos((float)i/(float)faces * 2.0f*pi));
+		mesh.vertices.push_back(Vertex{ .pos = vec3(p.x, bot, p.y), .norm = vec3(0.0f, -1.0f, 0.0f) });
+	}
+	for (int i = 1; i < faces - 1; i++) { // top
+		mesh.indices.insert(mesh.indices.end(), { top_base, top_base+i, top_base+i+1 });
+	}
+	for (int i = 1; i < faces - 1; i++) { // bot
+		mesh.indices.insert(mesh.indices.end(), { bot_base, bot_base+i+1, bot_base+i });
+	}
+
+	return mesh;
+}
+
+// --bench-genverts: CPU mesh generation throughput before (genPrismReference) and after (genPrism)
+void benchGenPrism() {
+	namespace chrono = std::chrono;
+#if defined(__AVX2__)
+	std::cout << "ringSinCos: AVX2" << std::endl;
+#elif defined(__SSE2__)
+	std::cout << "ringSinCos: SSE2" << std::endl;
+#else
+	std::cout << "ringSinCos: scalar" << std::endl;
+#endif
+	std::cout << "faces\tbefore (Mverts/s)\tafter (Mverts/s)\tspeedup\tmax position error" << std::endl;
+	for (int faces : { 4, 16, 256, 4096, 65536, 1000000 }) {
+		// roughly the same amount of work per row
+		const int reps = std::max(3, 4000000 / faces);
+		usize verts = 0;
+
+		auto start = chrono::steady_clock::now();
+		for (int r = 0; r < reps; r++) verts += genPrismReference(faces).vertices.size();
+		const double before = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		start = chrono::steady_clock::now();
+		for (int r = 0; r < reps; r++) verts -= genPrism(faces).vertices.size();
+		const double after = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		const Mesh a = genPrismReference(faces), b = genPrism(faces);
+		float err = 0.0f;
+		for (usize i = 0; i < a.vertices.size(); i++) {
+			err = std::max(err, glm::length(a.vertices[i].pos - b.vertices[i].pos));
+		}
+
+		const double n = (double)faces*6 * reps;
+		std::cout << faces << "\t" << n / before / 1e6 << "\t" << n / after / 1e6 << "\t" << before / after << "x\t" << err << (verts != 0 ? " (size mismatch)" : "") << std::endl;
+	}
+}
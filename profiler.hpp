@@ -0,0 +1,111 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Scoped CPU profiling markers, dumped as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+// Each thread appends to its own ring of the last `capacity` events, so recording takes no lock,
+// only steady_clock reads. Build with -DNPROFILE to compile every marker out.
+//
+//	PROFILE_SCOPE("render");       // until the end of the enclosing block
+//	PROFILE_THREAD("mesh builder"); // once per thread, names its track
+//	profileDump("trace.json");     // after other threads are joined
+struct ProfileEvent {
+	const char *name;
+	uint64_t begin_ns;
+	uint64_t end_ns;
+};
+
+struct ProfileRing {
+	static constexpr size_t capacity = 1 << 16;
+	std::array<ProfileEvent, capacity> events;
+	std::atomic<size_t> count; // total ever recorded, the ring keeps the newest `capacity`
+	uint tid;
+	const char *thread_name;
+};
+
+struct Profiler {
+	std::mutex mutex; // only for registering rings
+	std::vector<std::unique_ptr<ProfileRing>> rings; // outlive their threads so dumps see them
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+inline Profiler profiler;
+
+inline uint64_t profileNow() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profiler.epoch).count();
+}
+
+inline ProfileRing *profileRing() {
+	thread_local ProfileRing *ring = nullptr;
+	if (ring == nullptr) {
+		std::lock_guard<std::mutex> lock(profiler.mutex);
+		profiler.rings.push_back(std::make_unique<ProfileRing>());
+		ring = profiler.rings.back().get();
+		ring->count = 0;
+		ring->tid = profiler.rings.size();
+		ring->thread_name = nullptr;
+	}
+	return ring;
+}
+
+inline void profileRecord(const char *const name, uint64_t begin_ns, uint64_t end_ns) {
+	ProfileRing *const ring = profileRing();
+	const size_t i = ring->count.load(std::memory_order_relaxed);
+	ring->events[i % ProfileRing::capacity] = ProfileEvent{ name, begin_ns, end_ns };
+	ring->count.store(i + 1, std::memory_order_release);
+}
+
+struct ProfileScope {
+	const char *name;
+	uint64_t begin_ns;
+
+	ProfileScope(const char *const name) : name(name), begin_ns(profileNow()) {}
+	~ProfileScope() { profileRecord(this->name, this->begin_ns, profileNow()); }
+};
+
+// event names and thread names must be string literals (or otherwise outlive the dump)
+void profileDump(const char *const filename) {
+	std::ofstream file(filename);
+	if (!file) {
+		std::cout << "Failed to open " << filename << std::endl;
+		return;
+	}
+	std::lock_guard<std::mutex> lock(profiler.mutex);
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+	for (const auto &ring : profiler.rings) {
+		if (ring->thread_name != nullptr) {
+			file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << ring->tid
+				<< ",\"args\":{\"name\":\"" << ring->thread_name << "\"}}";
+			first = false;
+		}
+		const size_t count = ring->count.load(std::memory_order_acquire);
+		const size_t begin = count > ProfileRing::capacity ? count - ProfileRing::capacity : 0;
+		for (size_t i = begin; i < count; i++) {
+			const ProfileEvent &event = ring->events[i % ProfileRing::capacity];
+			// microseconds, the unit trace viewers expect
+			file << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << ring->tid
+				<< ",\"ts\":" << (double)event.begin_ns / 1e3 << ",\"dur\":" << (double)(event.end_ns - event.begin_ns) / 1e3 << "}";
+			first = false;
+		}
+	}
+	file << "\n]}\n";
+	std::cout << "wrote trace " << filename << std::endl;
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#ifndef NPROFILE
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_THREAD(name) (profileRing()->thread_name = (name))
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
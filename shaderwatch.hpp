@@ -0,0 +1,90 @@
+#pragma once
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Hot reload for a vertex/fragment program. inotify reports saves to either file, the program is
+// rebuilt in the background (ProgramBuild) and swapped in between frames once the driver is done.
+// Until then, and for good if the edit doesn't compile, the old program keeps drawing.
+struct ShaderWatcher {
+	struct File {
+		int wd; // watch on the file's directory, editors often save by replacing the file
+		std::string name;
+	};
+
+	int fd;
+	std::array<const char*, 2> filenames; // vertex, fragment
+	std::array<File, 2> files;
+	std::string defines; // passed on to ProgramBuild::init
+	bool changed;
+	bool building;
+	ProgramBuild build;
+
+	static ShaderWatcher init(const char *const vert_filename, const char *const frag_filename, const std::string &defines = "") {
+		ShaderWatcher watcher = {};
+		watcher.filenames = { vert_filename, frag_filename };
+		watcher.defines = defines;
+#ifdef EMBED_SHADERS
+		watcher.fd = -1; // the sources are compiled in, nothing to watch
+		return watcher;
+#endif
+		watcher.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (watcher.fd < 0) {
+			std::cout << "Failed to initialize inotify, shader hot reload disabled" << std::endl;
+			return watcher;
+		}
+		for (usize i = 0; i < watcher.files.size(); i++) {
+			const std::filesystem::path path(watcher.filenames[i]);
+			const std::string dir = path.has_parent_path() ? path.parent_path().string() : ".";
+			// watching the same directory twice returns the same wd
+			watcher.files[i].wd = inotify_add_watch(watcher.fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+			watcher.files[i].name = path.filename().string();
+		}
+		return watcher;
+	}
+
+	void deinit() {
+		if (this->building) glDeleteProgram(this->build.finish());
+		if (this->fd >= 0) close(this->fd);
+		this->fd = -1;
+	}
+
+	// Call once per frame on the GL thread. Replaces (and deletes) *program when a rebuild succeeded.
+	void poll(uint *const program) {
+		if (this->fd < 0) return;
+		alignas(inotify_event) char buf[4096];
+		ssize_t len;
+		while ((len = read(this->fd, buf, sizeof(buf))) > 0) {
+			for (char *ptr = buf; ptr < buf + len; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(ptr)->len) {
+				const inotify_event *const event = reinterpret_cast<inotify_event*>(ptr);
+				if (event->len == 0) continue;
+				for (const File &file : this->files) {
+					if (event->wd == file.wd && file.name == event->name) this->changed = true;
+				}
+			}
+		}
+
+		if (this->building && this->build.ready()) {
+			this->building = false;
+			const uint rebuilt = this->build.finish();
+			if (rebuilt != 0) {
+				glDeleteProgram(*program);
+				*program = rebuilt;
+				std::cout << "reloaded " << this->filenames[0] << ", " << this->filenames[1] << std::endl;
+			}
+		}
+		// one build at a time, saves during a build are picked up once it's done
+		if (this->changed && !this->building) {
+			this->changed = false;
+			try {
+				this->build = ProgramBuild::init({ { GL_VERTEX_SHADER, this->filenames[0] }, { GL_FRAGMENT_SHADER, this->filenames[1] } }, this->defines);
+				this->building = true;
+			} catch (const std::ios_base::failure &) {
+				// mid-save, the write that completes it triggers another event
+			}
+		}
+	}
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Lock-free bounded FIFO for exactly one producer and one consumer thread. push() and pop() are
+// wait-free: a full queue rejects the push instead of blocking the producer.
+template<typename T, size_t capacity>
+struct SpscQueue {
+	static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+	std::array<T, capacity> items;
+	// on separate cache lines so the two threads don't keep stealing each other's line
+	alignas(64) std::atomic<size_t> head; // next to pop, written by the consumer
+	alignas(64) std::atomic<size_t> tail; // next to push, written by the producer
+
+	// not copyable (atomics), so initialized in place
+	void reset() {
+		this->head.store(0, std::memory_order_relaxed);
+		this->tail.store(0, std::memory_order_relaxed);
+	}
+
+	// producer, false if the queue is full
+	bool push(const T &item) {
+		const size_t tail = this->tail.load(std::memory_order_relaxed);
+		if (tail - this->head.load(std::memory_order_acquire) == capacity) return false;
+		this->items[tail % capacity] = item;
+		this->tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer, the oldest item or nullptr if empty; stays valid until pop()
+	const T *peek() const {
+		const size_t head = this->head.load(std::memory_order_relaxed);
+		if (head == this->tail.load(std::memory_order_acquire)) return nullptr;
+		return &this->items[head % capacity];
+	}
+
+	// consumer, only after peek() returned an item
+	void pop() {
+		this->head.store(this->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+};
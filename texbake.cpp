@@ -0,0 +1,85 @@
+// Bakes images into .dds files that the streamer and loadDDSToTexture2Ds upload without decoding
+// anything: full mip chain, compressed with the same encoders as the texture streamer. Runs without a
+// GL context and never touches ./texture_cache, so it builds without glfw or the glad loader.
+// ./texbake [--format rgba8|bc1|bc3|bc7] [--out DIR] IMAGE...
+#include <glad/gl.h> // only for the GL format enums in texcompress.hpp
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include <array>
+#include <cstring>
+#include <string>
+
+typedef unsigned char uchar;
+typedef uint32_t uint;
+typedef size_t usize;
+
+#include "profiler.hpp"
+#include "texcompress.hpp"
+#include "dds.hpp"
+
+int main(int argc, char **argv) {
+	TextureFormat format = TEXTURE_BC7;
+	std::string out_dir;
+	std::vector<const char*> inputs;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			const char *const name = argv[++i];
+			if (!parseTextureFormat(name, &format)) {
+				std::cout << "Unknown format " << name << std::endl;
+				exit(-1);
+			}
+		} else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			out_dir = argv[++i];
+		} else if (argv[i][0] == '-') {
+			std::cout << "usage: " << argv[0] << " [--format rgba8|bc1|bc3|bc7] [--out DIR] IMAGE..." << std::endl;
+			exit(-1);
+		} else {
+			inputs.push_back(argv[i]);
+		}
+	}
+	if (!out_dir.empty()) {
+		std::error_code error;
+		std::filesystem::create_directories(out_dir, error);
+	}
+
+	std::atomic<usize> next = 0;
+	std::atomic<bool> failed = false;
+	std::vector<std::thread> workers;
+	for (uint t = 0; t < std::max(1u, std::thread::hardware_concurrency()); t++) {
+		workers.emplace_back([&] {
+			for (usize i = next++; i < inputs.size(); i = next++) {
+				std::ifstream file(inputs[i], std::ios::binary);
+				const std::vector<char> bytes{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+				int width, height, channels;
+				uchar *const rgba = bytes.empty() ? nullptr : stbi_load_from_memory(reinterpret_cast<const uchar*>(bytes.data()), bytes.size(), &width, &height, &channels, 4);
+				if (rgba == nullptr) {
+					std::cout << "Failed to bake " << inputs[i] << ", can't read it as an image" << std::endl;
+					failed = true;
+					continue;
+				}
+				const MipChain chain = buildMipChain(format, rgba, width, height);
+				stbi_image_free(rgba);
+				std::filesystem::path path(inputs[i]);
+				path.replace_extension(".dds");
+				if (!out_dir.empty()) path = std::filesystem::path(out_dir) / path.filename();
+				if (!writeDDS(path.c_str(), format, width, height, chain.levels, chain.pixels.data(), chain.level_offsets.data())) {
+					std::cout << "Failed to bake " << inputs[i] << std::endl;
+					failed = true;
+				}
+			}
+		});
+	}
+	for (std::thread &worker : workers) worker.join();
+	return failed ? -1 : 0;
+}
@@ -0,0 +1,334 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// CPU block compression of RGBA8 images, 4x4 texels per block:
+// BC1 (RGB, 8 B/block, 8x smaller), BC3 (BC1 + BC4 alpha, 16 B/block, 4x) and BC7 (16 B/block, 4x,
+// mode 6 only: one RGBA line per block with 16 steps, which handles smooth and noisy content well).
+enum TextureFormat {
+	TEXTURE_RGBA8,
+	TEXTURE_BC1,
+	TEXTURE_BC3,
+	TEXTURE_BC7,
+};
+
+// largest width or height we load, GL 4.5's minimum GL_MAX_TEXTURE_SIZE; also keeps level sizes
+// far from overflowing
+constexpr int TEXTURE_MAX_SIZE = 16384;
+
+// "rgba8", "bc1", "bc3" or "bc7", false for anything else
+bool parseTextureFormat(const char *const name, TextureFormat *const format) {
+	if (std::strcmp(name, "rgba8") == 0) *format = TEXTURE_RGBA8;
+	else if (std::strcmp(name, "bc1") == 0) *format = TEXTURE_BC1;
+	else if (std::strcmp(name, "bc3") == 0) *format = TEXTURE_BC3;
+	else if (std::strcmp(name, "bc7") == 0) *format = TEXTURE_BC7;
+	else return false;
+	return true;
+}
+
+// BC1/BC3 are the S3TC formats, an extension even in GL 4.6 (see textureFormatSupported); BC7 is core
+GLenum textureInternalFormat(TextureFormat format) {
+	switch (format) {
+	case TEXTURE_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case TEXTURE_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case TEXTURE_BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	default: return GL_RGBA8;
+	}
+}
+
+// bytes of one level
+usize textureLevelSize(TextureFormat format, int width, int height) {
+	const usize blocks = (usize)((width + 3) / 4) * ((height + 3) / 4);
+	switch (format) {
+	case TEXTURE_BC1: return blocks * 8;
+	case TEXTURE_BC3: return blocks * 16;
+	case TEXTURE_BC7: return blocks * 16;
+	default: return (usize)width * height * 4;
+	}
+}
+
+// floor(log2(max(width, height))) + 1, the levels of a full mip chain
+int textureFullLevels(int width, int height) {
+	int levels = 1;
+	while ((std::max(width, height) >> levels) > 0) levels++;
+	return levels;
+}
+
+// where each of `levels` levels starts with all of them back to back, plus the total size last
+std::vector<usize> textureLevelOffsets(TextureFormat format, int width, int height, int levels) {
+	std::vector<usize> offsets = { 0 };
+	for (int level = 0; level < levels; level++) {
+		offsets.push_back(offsets.back() + textureLevelSize(format, std::max(1, width >> level), std::max(1, height >> level)));
+	}
+	return offsets;
+}
+
+namespace bc_detail {
+	// endpoints of the line through the block's colors that best fits them (principal axis),
+	// over the first `channels` channels
+	void fitLine(const uchar block[16][4], int channels, float lo[4], float hi[4]) {
+		float mean[4] = {};
+		for (int i = 0; i < 16; i++) for (int c = 0; c < channels; c++) mean[c] += block[i][c] / 16.0f;
+		float cov[4][4] = {};
+		for (int i = 0; i < 16; i++) {
+			for (int a = 0; a < channels; a++) {
+				for (int b = 0; b < channels; b++) cov[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+			}
+		}
+		// power iteration, seeded with the diagonal so it never starts orthogonal to the answer
+		float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		for (int c = 0; c < channels; c++) axis[c] = cov[c][c] + 1e-3f;
+		for (int iter = 0; iter < 8; iter++) {
+			float next[4] = {}, len = 0.0f;
+			for (int a = 0; a < channels; a++) {
+				for (int b = 0; b < channels; b++) next[a] += cov[a][b] * axis[b];
+				len = std::max(len, std::abs(next[a]));
+			}
+			if (len < 1e-6f) break; // flat block
+			for (int c = 0; c < channels; c++) axis[c] = next[c] / len;
+		}
+		float norm = 0.0f;
+		for (int c = 0; c < channels; c++) norm += axis[c] * axis[c];
+		norm = std::sqrt(norm);
+		for (int c = 0; c < channels; c++) axis[c] /= norm;
+
+		float t_min = 0.0f, t_max = 0.0f;
+		for (int i = 0; i < 16; i++) {
+			float t = 0.0f;
+			for (int c = 0; c < channels; c++) t += (block[i][c] - mean[c]) * axis[c];
+			t_min = std::min(t_min, t);
+			t_max = std::max(t_max, t);
+		}
+		for (int c = 0; c < channels; c++) {
+			lo[c] = std::clamp(mean[c] + axis[c] * t_min, 0.0f, 255.0f);
+			hi[c] = std::clamp(mean[c] + axis[c] * t_max, 0.0f, 255.0f);
+		}
+	}
+
+	uint16_t pack565(const float c[4]) {
+		const uint r = (uint)std::lround(c[0] * 31.0f / 255.0f);
+		const uint g = (uint)std::lround(c[1] * 63.0f / 255.0f);
+		const uint b = (uint)std::lround(c[2] * 31.0f / 255.0f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void unpack565(uint16_t v, int out[3]) {
+		const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+		out[0] = (r << 3) | (r >> 2);
+		out[1] = (g << 2) | (g >> 4);
+		out[2] = (b << 3) | (b >> 2);
+	}
+
+	// BC1 color block in 4-color mode, which is also how BC3 reads it
+	void encodeColor(const uchar block[16][4], uchar out[8]) {
+		float lo[4], hi[4];
+		fitLine(block, 3, lo, hi);
+		uint16_t c0 = pack565(hi), c1 = pack565(lo);
+		if (c0 < c1) std::swap(c0, c1);
+		uint indices = 0;
+		if (c0 != c1) { // equal endpoints would select 3-color mode, index 0 is right for all texels then
+			int palette[4][3];
+			unpack565(c0, palette[0]);
+			unpack565(c1, palette[1]);
+			for (int c = 0; c < 3; c++) {
+				palette[2][c] = (2*palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2*palette[1][c]) / 3;
+			}
+			for (int i = 0; i < 16; i++) {
+				int best = 0, best_err = INT32_MAX;
+				for (int p = 0; p < 4; p++) {
+					int err = 0;
+					for (int c = 0; c < 3; c++) err += (block[i][c] - palette[p][c]) * (block[i][c] - palette[p][c]);
+					if (err < best_err) best = p, best_err = err;
+				}
+				indices |= (uint)best << (2*i);
+			}
+		}
+		out[0] = c0 & 0xFF;
+		out[1] = c0 >> 8;
+		out[2] = c1 & 0xFF;
+		out[3] = c1 >> 8;
+		std::memcpy(out + 4, &indices, 4);
+	}
+
+	// BC4 in 8-value mode (a0 > a1)
+	void encodeAlpha(const uchar block[16][4], uchar out[8]) {
+		int a0 = 0, a1 = 255;
+		for (int i = 0; i < 16; i++) {
+			a0 = std::max(a0, (int)block[i][3]);
+			a1 = std::min(a1, (int)block[i][3]);
+		}
+		uint64_t indices = 0;
+		if (a0 != a1) {
+			int palette[8] = { a0, a1 };
+			for (int p = 1; p < 7; p++) palette[p+1] = ((7-p)*a0 + p*a1) / 7;
+			for (int i = 0; i < 16; i++) {
+				int best = 0;
+				for (int p = 1; p < 8; p++) {
+					if (std::abs(block[i][3] - palette[p]) < std::abs(block[i][3] - palette[best])) best = p;
+				}
+				indices |= (uint64_t)best << (3*i);
+			}
+		}
+		out[0] = a0;
+		out[1] = a1;
+		for (int b = 0; b < 6; b++) out[2 + b] = (indices >> (8*b)) & 0xFF;
+	}
+
+	constexpr int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// BC7 mode 6: RGBA endpoints with 7 bits per channel plus a shared lowest bit (p-bit) each
+	void encodeBC7(const uchar block[16][4], uchar out[16]) {
+		float lo[4], hi[4];
+		fitLine(block, 4, lo, hi);
+
+		// opaque blocks must decode to alpha 255 exactly, which takes both p-bits set
+		bool opaque = true;
+		for (int i = 0; i < 16; i++) opaque = opaque && block[i][3] == 255;
+
+		int best_err = INT32_MAX;
+		int best_q[2][4] = {}, best_p[2] = {}, best_idx[16] = {};
+		for (int pbits = opaque ? 3 : 0; pbits < 4; pbits++) {
+			const int p[2] = { pbits & 1, pbits >> 1 };
+			int q[2][4], e[2][4];
+			for (int c = 0; c < 4; c++) {
+				q[0][c] = std::clamp((int)std::lround((lo[c] - p[0]) / 2.0f), 0, 127);
+				q[1][c] = std::clamp((int)std::lround((hi[c] - p[1]) / 2.0f), 0, 127);
+				e[0][c] = (q[0][c] << 1) | p[0];
+				e[1][c] = (q[1][c] << 1) | p[1];
+			}
+			int dir[4], dir_len2 = 0;
+			for (int c = 0; c < 4; c++) {
+				dir[c] = e[1][c] - e[0][c];
+				dir_len2 += dir[c] * dir[c];
+			}
+			int err = 0, idx[16];
+			for (int i = 0; i < 16; i++) {
+				// project onto the quantized line, then check the nearest weights around it
+				int dot = 0;
+				for (int c = 0; c < 4; c++) dot += (block[i][c] - e[0][c]) * dir[c];
+				const float t = dir_len2 > 0 ? std::clamp((float)dot / (float)dir_len2, 0.0f, 1.0f) : 0.0f;
+				const int guess = std::lround(t * 15.0f);
+				int best = 0, best_texel_err = INT32_MAX;
+				for (int k = std::max(0, guess - 1); k <= std::min(15, guess + 1); k++) {
+					int texel_err = 0;
+					for (int c = 0; c < 4; c++) {
+						const int v = (e[0][c] * (64 - BC7_WEIGHTS[k]) + e[1][c] * BC7_WEIGHTS[k] + 32) >> 6;
+						texel_err += (block[i][c] - v) * (block[i][c] - v);
+					}
+					if (texel_err < best_texel_err) best = k, best_texel_err = texel_err;
+				}
+				idx[i] = best;
+				err += best_texel_err;
+			}
+			if (err < best_err) {
+				best_err = err;
+				std::memcpy(best_q, q, sizeof(q));
+				best_p[0] = p[0];
+				best_p[1] = p[1];
+				std::memcpy(best_idx, idx, sizeof(idx));
+			}
+		}
+		// the first index is stored with its top bit implied 0, swap the endpoints if it's set
+		if (best_idx[0] & 8) {
+			for (int c = 0; c < 4; c++) std::swap(best_q[0][c], best_q[1][c]);
+			std::swap(best_p[0], best_p[1]);
+			for (int i = 0; i < 16; i++) best_idx[i] = 15 - best_idx[i];
+		}
+
+		uint64_t bits[2] = {};
+		int pos = 0;
+		auto put = [&](uint64_t value, int count) {
+			for (int b = 0; b < count; b++, pos++) bits[pos / 64] |= ((value >> b) & 1) << (pos % 64);
+		};
+		put(1 << 6, 7); // mode 6
+		for (int c = 0; c < 4; c++) {
+			put(best_q[0][c], 7);
+			put(best_q[1][c], 7);
+		}
+		put(best_p[0], 1);
+		put(best_p[1], 1);
+		put(best_idx[0], 3);
+		for (int i = 1; i < 16; i++) put(best_idx[i], 4);
+		std::memcpy(out, bits, 16);
+	}
+}
+
+// compresses one RGBA8 level, texels past the edge of partial blocks repeat the edge
+void compressLevel(TextureFormat format, const uchar *const rgba, int width, int height, uchar *const out) {
+	const int blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+	const usize block_size = format == TEXTURE_BC1 ? 8 : 16;
+	for (int by = 0; by < blocks_y; by++) {
+		for (int bx = 0; bx < blocks_x; bx++) {
+			uchar block[16][4];
+			for (int i = 0; i < 16; i++) {
+				const int x = std::min(bx*4 + i % 4, width - 1), y = std::min(by*4 + i / 4, height - 1);
+				std::memcpy(block[i], rgba + ((usize)y*width + x)*4, 4);
+			}
+			uchar *const dst = out + ((usize)by*blocks_x + bx) * block_size;
+			switch (format) {
+			case TEXTURE_BC1:
+				bc_detail::encodeColor(block, dst);
+				break;
+			case TEXTURE_BC3:
+				bc_detail::encodeAlpha(block, dst);
+				bc_detail::encodeColor(block, dst + 8);
+				break;
+			case TEXTURE_BC7:
+				bc_detail::encodeBC7(block, dst);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+}
+
+// all levels of a texture back to back, largest first
+struct MipChain {
+	int levels;
+	std::vector<uchar> pixels;
+	std::vector<usize> level_offsets; // levels + 1 entries, the last is the total size
+};
+
+// Box-filters the full mip chain of an RGBA8 image (odd edges clamp) and encodes every level in `format`
+MipChain buildMipChain(TextureFormat format, const uchar *const rgba, int width, int height) {
+	MipChain chain = {};
+	chain.levels = textureFullLevels(width, height);
+
+	std::vector<usize> rgba_offsets = textureLevelOffsets(TEXTURE_RGBA8, width, height, chain.levels);
+	std::vector<uchar> levels(rgba_offsets.back());
+	std::memcpy(levels.data(), rgba, (usize)width * height * 4);
+	for (int level = 1; level < chain.levels; level++) {
+		const int src_w = std::max(1, width >> (level-1)), src_h = std::max(1, height >> (level-1));
+		const int dst_w = std::max(1, width >> level), dst_h = std::max(1, height >> level);
+		const uchar *const src = levels.data() + rgba_offsets[level-1];
+		uchar *const dst = levels.data() + rgba_offsets[level];
+		for (int y = 0; y < dst_h; y++) {
+			const int y0 = std::min(2*y, src_h-1), y1 = std::min(2*y + 1, src_h-1);
+			for (int x = 0; x < dst_w; x++) {
+				const int x0 = std::min(2*x, src_w-1), x1 = std::min(2*x + 1, src_w-1);
+				for (int c = 0; c < 4; c++) {
+					const int sum = src[(y0*src_w + x0)*4 + c] + src[(y0*src_w + x1)*4 + c]
+						+ src[(y1*src_w + x0)*4 + c] + src[(y1*src_w + x1)*4 + c];
+					dst[(y*dst_w + x)*4 + c] = (uchar)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+	if (format == TEXTURE_RGBA8) {
+		chain.pixels = std::move(levels);
+		chain.level_offsets = std::move(rgba_offsets);
+		return chain;
+	}
+
+	chain.level_offsets = textureLevelOffsets(format, width, height, chain.levels);
+	chain.pixels.resize(chain.level_offsets.back());
+	PROFILE_SCOPE("compressLevel");
+	for (int level = 0; level < chain.levels; level++) {
+		compressLevel(format, levels.data() + rgba_offsets[level], std::max(1, width >> level), std::max(1, height >> level), chain.pixels.data() + chain.level_offsets[level]);
+	}
+	return chain;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+
+// The textures instances pick from by index (`Instance::tex`). With GL_ARB_bindless_texture every
+// file is its own GL_TEXTURE_2D of any size, and the fragment shader samples it through a resident
+// handle read from an SSBO, so nothing is bound per draw however many there are. Without it they're
+// the layers of one GL_TEXTURE_2D_ARRAY (loadImagesToTexture2DArray) and must share a size.
+struct TextureSet {
+	static constexpr uint handles_binding = 5; // TextureHandles in 3d.frag, 2-4 are prism.comp's
+	static constexpr uint array_unit = 0;      // textures in 3d.frag
+
+	bool bindless;
+	std::vector<uint> textures; // bindless: one per loaded file, else just the array
+	std::vector<GLuint64> handles;
+	uint handle_buffer;
+	int count; // instances may use indices [0, count)
+
+	static bool bindlessSupported() {
+		return GLAD_GL_ARB_bindless_texture;
+	}
+
+	// shader defines matching init(), for ProgramBuild::init
+	static std::string defines(bool bindless) {
+		return bindless ? "#define BINDLESS\n" : "";
+	}
+
+	// `bindless` only if bindlessSupported(), `format` only if textureFormatSupported(); .dds files
+	// keep their own format
+	static TextureSet init(const std::vector<const char*> &filenames, bool bindless, TextureFormat format) {
+		TextureSet set = {};
+		set.bindless = bindless;
+		if (filenames.empty()) return set;
+		if (!bindless) {
+			set.textures.resize(1);
+			glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, set.textures.data());
+			for (const int layer : loadImagesToTexture2DArray(filenames.size(), filenames.data(), set.textures[0], format)) {
+				set.count = std::max(set.count, layer + 1);
+			}
+			setSampling(set.textures[0]);
+			return set;
+		}
+
+		std::vector<uint> loaded(filenames.size());
+		glCreateTextures(GL_TEXTURE_2D, loaded.size(), loaded.data());
+		loadImagesToTexture2Ds(filenames.size(), filenames.data(), loaded.data(), format);
+		for (const uint texture : loaded) {
+			int immutable = GL_FALSE;
+			glGetTextureParameteriv(texture, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+			if (!immutable) { // failed to load, it never got storage
+				glDeleteTextures(1, &texture);
+				continue;
+			}
+			setSampling(texture); // before taking the handle, which freezes the sampling state
+			const GLuint64 handle = glGetTextureHandleARB(texture);
+			glMakeTextureHandleResidentARB(handle);
+			set.textures.push_back(texture);
+			set.handles.push_back(handle);
+		}
+		set.count = set.handles.size();
+		glCreateBuffers(1, &set.handle_buffer);
+		glNamedBufferStorage(set.handle_buffer, std::max<usize>(1, set.handles.size()) * sizeof(GLuint64), set.handles.data(), 0);
+		return set;
+	}
+
+	void deinit() {
+		for (const GLuint64 handle : this->handles) glMakeTextureHandleNonResidentARB(handle);
+		glDeleteTextures(this->textures.size(), this->textures.data());
+		glDeleteBuffers(1, &this->handle_buffer);
+		*this = {};
+	}
+
+	// binding points stay put, so once is enough
+	void bind() const {
+		if (this->bindless) {
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, handles_binding, this->handle_buffer);
+		} else if (!this->textures.empty()) {
+			glBindTextureUnit(array_unit, this->textures[0]);
+		}
+	}
+
+	static void setSampling(uint texture) {
+		glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+};
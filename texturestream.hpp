@@ -0,0 +1,501 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compressed mip chains are cached on disk, keyed by the image file's contents, so each asset is
+// only encoded once. Bump the version when the encoders or the mip filter change.
+constexpr const char *TEXTURE_CACHE_DIR = "./texture_cache";
+constexpr uint TEXTURE_CACHE_VERSION = 3;
+
+struct TextureCacheHeader {
+	uint version;
+	uint format;
+	int width;
+	int height;
+	int levels;
+};
+
+// BC1/BC3 (S3TC) need GL_EXT_texture_compression_s3tc; without it their storage silently fails
+// and the texture samples black
+bool textureFormatSupported(TextureFormat format) {
+	return (format != TEXTURE_BC1 && format != TEXTURE_BC3) || GLAD_GL_EXT_texture_compression_s3tc;
+}
+
+// parseDDS, also rejecting formats this GL can't sample (dds.hpp stays GL-free for texbake)
+bool parseLoadableDDS(const char *const data, const usize size, DdsInfo *const info) {
+	return parseDDS(data, size, info) && textureFormatSupported(info->format);
+}
+
+// Streams image files into textures. A pool of workers decodes them, builds their mip chains and
+// compresses them in parallel (.dds files are only read, they come baked), then the GL thread copies
+// finished levels into a persistently mapped PBO ring and uploads them from there, smallest level
+// first. GL_TEXTURE_BASE_LEVEL follows the finest level uploaded so far, so a texture shows up blurry
+// right away and sharpens over the next frames.
+struct TextureStreamer {
+	static constexpr usize ring_alignment = 256;
+
+	struct Request {
+		std::string filename;
+		uint texture;
+		int layer;
+	};
+
+	struct Image {
+		uint texture;
+		int layer; // -1 for a GL_TEXTURE_2D
+		int width;
+		int height;
+		int levels;
+		int next_level; // next to upload, counts down to 0
+		TextureFormat format; // the streamer's, or a .dds file's own
+		std::vector<uchar> pixels; // all levels back to back in `format`
+		std::vector<usize> level_offsets; // levels + 1 entries, the last is the total size
+		// .dds files: the mapped file, levels upload straight from it at `file_offset` and pixels stays empty
+		FileView file;
+		usize file_offset;
+
+		const uchar *levelData(int level) const {
+			const uchar *const base = this->file.data != nullptr ? reinterpret_cast<const uchar*>(this->file.data) + this->file_offset : this->pixels.data();
+			return base + this->level_offsets[level];
+		}
+	};
+
+	struct Batch {
+		usize size; // ring bytes used by one poll(), padding included
+		GLsync fence;
+	};
+
+	TextureFormat format;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable work_cv;
+	std::condition_variable decoded_cv;
+	// guarded by mutex
+	bool quit;
+	std::deque<Request> requests;
+	std::vector<Image> decoded;
+	usize pending; // requested but not handed to the GL thread yet
+
+	// GL thread only
+	std::deque<Image> uploading;
+	uint ring;
+	uchar *ring_ptr;
+	usize ring_capacity;
+	usize ring_head;
+	usize ring_used;
+	usize batch_size; // ring bytes used by the current poll()
+	std::deque<Batch> batches;
+
+	// not copyable (threads, mutex), so initialized in place
+	void start(usize worker_count, usize ring_capacity, TextureFormat format) {
+		this->format = format;
+		this->quit = false;
+		this->pending = 0;
+		this->ring_capacity = (ring_capacity + ring_alignment - 1) / ring_alignment * ring_alignment;
+		this->ring_head = 0;
+		this->ring_used = 0;
+		this->batch_size = 0;
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(1, &this->ring);
+		glNamedBufferStorage(this->ring, this->ring_capacity, nullptr, flags);
+		this->ring_ptr = reinterpret_cast<uchar*>(glMapNamedBufferRange(this->ring, 0, this->ring_capacity, flags));
+
+		for (usize i = 0; i < worker_count; i++) {
+			this->workers.emplace_back(&TextureStreamer::run, this);
+		}
+	}
+
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->quit = true;
+		}
+		this->work_cv.notify_all();
+		for (std::thread &worker : this->workers) worker.join();
+		this->workers.clear();
+		for (const Batch &batch : this->batches) {
+			glClientWaitSync(batch.fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+			glDeleteSync(batch.fence);
+		}
+		this->batches.clear();
+		for (Image &image : this->uploading) image.file.deinit();
+		this->uploading.clear();
+		for (Image &image : this->decoded) image.file.deinit();
+		this->decoded.clear();
+		glDeleteBuffers(1, &this->ring);
+		this->ring = 0;
+	}
+
+	// `texture` must come from glCreateTextures(GL_TEXTURE_2D); its storage is allocated once decoded.
+	// With a `layer`, it's a GL_TEXTURE_2D_ARRAY whose storage the caller allocated already, with the
+	// image's size, levels and format (see imageInfo). BASE_LEVEL is shared by all layers,
+	// so layers don't sharpen progressively: their finer levels read as black until uploaded.
+	void request(const char *const filename, uint texture, int layer = -1) {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->requests.push_back(Request{ filename, texture, layer });
+			this->pending++;
+		}
+		this->work_cv.notify_one();
+	}
+
+	// Call on the GL thread, e.g. once per frame. Uploads roughly `budget` bytes of decoded levels
+	// (at least one) without ever waiting on the GPU. True once every request is fully uploaded.
+	bool poll(usize budget) {
+		this->retire();
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			for (Image &image : this->decoded) {
+				if (image.layer < 0) {
+					glTextureStorage2D(image.texture, image.levels, textureInternalFormat(image.format), image.width, image.height);
+				}
+				this->uploading.push_back(std::move(image));
+			}
+			this->pending -= this->decoded.size();
+			this->decoded.clear();
+		}
+
+		usize uploaded = 0;
+		while (!this->uploading.empty() && (uploaded == 0 || uploaded < budget)) {
+			Image &image = this->uploading.front();
+			const int level = image.next_level;
+			const int width = std::max(1, image.width >> level), height = std::max(1, image.height >> level);
+			const usize size = image.level_offsets[level+1] - image.level_offsets[level];
+			const uchar *src = image.levelData(level);
+			usize offset;
+			if (size > this->ring_capacity) {
+				// too big for the ring at all, upload straight from client memory
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			} else {
+				if (!this->allocate(size, &offset)) break; // ring full until the GPU catches up
+				std::memcpy(this->ring_ptr + offset, src, size);
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->ring);
+				src = reinterpret_cast<const uchar*>(offset);
+			}
+			if (image.layer >= 0 && image.format == TEXTURE_RGBA8) {
+				glTextureSubImage3D(image.texture, level, 0, 0, image.layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, src);
+			} else if (image.layer >= 0) {
+				glCompressedTextureSubImage3D(image.texture, level, 0, 0, image.layer, width, height, 1, textureInternalFormat(image.format), size, src);
+			} else if (image.format == TEXTURE_RGBA8) {
+				glTextureSubImage2D(image.texture, level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, src);
+			} else {
+				glCompressedTextureSubImage2D(image.texture, level, 0, 0, width, height, textureInternalFormat(image.format), size, src);
+			}
+			if (image.layer < 0) glTextureParameteri(image.texture, GL_TEXTURE_BASE_LEVEL, level);
+			uploaded += size;
+			if (level == 0) {
+				image.file.deinit(); // the level is in the ring or, if it went direct, copied by the driver
+				this->uploading.pop_front();
+			} else {
+				image.next_level--;
+			}
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (this->batch_size > 0) {
+			this->batches.push_back(Batch{ this->batch_size, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+			this->batch_size = 0;
+		}
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		return this->pending == 0 && this->uploading.empty();
+	}
+
+	// blocks until every request is fully uploaded
+	void finish() {
+		while (!this->poll(SIZE_MAX)) {
+			if (!this->uploading.empty() && !this->batches.empty()) {
+				glClientWaitSync(this->batches.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->decoded_cv.wait(lock, [this] { return !this->decoded.empty() || this->pending == 0; });
+		}
+	}
+
+	// frees ring space of uploads the GPU has finished
+	void retire() {
+		while (!this->batches.empty() && glClientWaitSync(this->batches.front().fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+			this->ring_used -= this->batches.front().size;
+			glDeleteSync(this->batches.front().fence);
+			this->batches.pop_front();
+		}
+		if (this->ring_used == 0 && this->batch_size == 0) this->ring_head = 0;
+	}
+
+	bool allocate(usize size, usize *const offset) {
+		size = (size + ring_alignment - 1) / ring_alignment * ring_alignment;
+		// never split an upload across the end of the ring, skip the tail instead
+		const usize padding = this->ring_head + size > this->ring_capacity ? this->ring_capacity - this->ring_head : 0;
+		if (this->ring_used + padding + size > this->ring_capacity) return false;
+		if (padding > 0) this->ring_head = 0;
+		*offset = this->ring_head;
+		this->ring_head = (this->ring_head + size) % this->ring_capacity;
+		this->ring_used += padding + size;
+		this->batch_size += padding + size;
+		return true;
+	}
+
+	void run() {
+		PROFILE_THREAD("texture decode");
+		std::unique_lock<std::mutex> lock(this->mutex);
+		while (true) {
+			this->work_cv.wait(lock, [this] { return this->quit || !this->requests.empty(); });
+			if (this->quit) return;
+			const Request request = std::move(this->requests.front());
+			this->requests.pop_front();
+			lock.unlock();
+
+			Image image = loadImage(request.filename.c_str(), request.texture, this->format);
+			image.layer = request.layer;
+
+			lock.lock();
+			if (image.levels > 0) {
+				this->decoded.push_back(std::move(image));
+			} else {
+				this->pending--;
+			}
+			this->decoded_cv.notify_all();
+		}
+	}
+
+	// levels = 0 if the file couldn't be read or decoded. .dds files keep their own format and levels.
+	static Image loadImage(const char *const filename, uint texture, TextureFormat format) {
+		PROFILE_SCOPE("loadImage");
+		Image image = {};
+		image.texture = texture;
+		image.format = format;
+		FileView file = FileView::init(filename);
+		if (file.data == nullptr) {
+			std::cout << "Failed to load texture " << filename << std::endl;
+			return image;
+		}
+		if (isDDSFile(filename)) {
+			DdsInfo info;
+			if (!parseLoadableDDS(file.data, file.size, &info)) {
+				std::cout << "Failed to load texture " << filename << ", not a supported DDS file" << std::endl;
+				file.deinit();
+				return image;
+			}
+			image.format = info.format;
+			image.width = info.width;
+			image.height = info.height;
+			image.levels = info.levels;
+			image.next_level = info.levels - 1;
+			image.level_offsets = textureLevelOffsets(info.format, info.width, info.height, info.levels);
+			// no copy here, poll() copies each level from the mapping into the ring
+			image.file = file;
+			image.file_offset = info.data_offset;
+			return image;
+		}
+		std::string cache_path;
+		if (format != TEXTURE_RGBA8) {
+			const uint key[2] = { TEXTURE_CACHE_VERSION, format };
+			char name[32];
+			std::snprintf(name, sizeof(name), "/%016llx.tex", (unsigned long long)hashBytes(key, sizeof(key), hashBytes(file.data, file.size)));
+			cache_path = TEXTURE_CACHE_DIR + std::string(name);
+			if (loadCachedImage(cache_path, format, &image)) {
+				file.deinit();
+				return image;
+			}
+		}
+
+		int channels;
+		uchar *data = stbi_load_from_memory(reinterpret_cast<const uchar*>(file.data), file.size, &image.width, &image.height, &channels, 4);
+		file.deinit();
+		if (data == nullptr) {
+			std::cout << "Failed to load texture " << filename << std::endl;
+			return image;
+		}
+		MipChain chain = buildMipChain(format, data, image.width, image.height);
+		stbi_image_free(data);
+		image.levels = chain.levels;
+		image.next_level = chain.levels - 1;
+		image.pixels = std::move(chain.pixels);
+		image.level_offsets = std::move(chain.level_offsets);
+		if (format == TEXTURE_RGBA8) return image;
+		storeCachedImage(cache_path, format, image);
+		return image;
+	}
+
+	static bool loadCachedImage(const std::string &path, TextureFormat format, Image *const image) {
+		FileView file = FileView::init(path.c_str());
+		TextureCacheHeader header;
+		if (file.data == nullptr || file.size < sizeof(header)) {
+			file.deinit();
+			return false;
+		}
+		std::memcpy(&header, file.data, sizeof(header));
+		// anything could be in the file, so check the header before sizing anything from it
+		if (header.version != TEXTURE_CACHE_VERSION || header.format != format || header.width <= 0 || header.height <= 0
+			|| header.width > TEXTURE_MAX_SIZE || header.height > TEXTURE_MAX_SIZE
+			|| header.levels < 1 || header.levels > textureFullLevels(header.width, header.height)) {
+			file.deinit();
+			return false;
+		}
+		std::vector<usize> offsets = textureLevelOffsets(format, header.width, header.height, header.levels);
+		if (file.size != sizeof(header) + offsets.back()) {
+			file.deinit();
+			return false;
+		}
+		image->width = header.width;
+		image->height = header.height;
+		image->levels = header.levels;
+		image->next_level = header.levels - 1;
+		image->level_offsets = std::move(offsets);
+		image->pixels.assign(file.data + sizeof(header), file.data + file.size);
+		file.deinit();
+		return true;
+	}
+
+	static void storeCachedImage(const std::string &path, TextureFormat format, const Image &image) {
+		const TextureCacheHeader header = { TEXTURE_CACHE_VERSION, format, image.width, image.height, image.levels };
+		std::error_code error;
+		std::filesystem::create_directories(TEXTURE_CACHE_DIR, error);
+		// write then rename, so a concurrent worker or launch never reads half a file
+		const std::string tmp_path = path + ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+		{
+			std::ofstream file(tmp_path, std::ios::binary);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(image.pixels.data()), image.pixels.size());
+			if (!file) return;
+		}
+		std::filesystem::rename(tmp_path, path, error);
+	}
+};
+
+// What TextureStreamer::loadImage will produce for the file, from its header alone: a .dds file's
+// own size, format and levels, else the image's size, `format` and a full mip chain. False if it
+// can't be read.
+bool imageInfo(const char *const filename, TextureFormat format, int *const width, int *const height, TextureFormat *const file_format, int *const levels) {
+	FileView file = FileView::init(filename);
+	bool ok = false;
+	if (file.data != nullptr && isDDSFile(filename)) {
+		DdsInfo info = {};
+		ok = parseLoadableDDS(file.data, file.size, &info);
+		*width = info.width;
+		*height = info.height;
+		*file_format = info.format;
+		*levels = info.levels;
+	} else if (file.data != nullptr) {
+		int channels;
+		ok = stbi_info_from_memory(reinterpret_cast<const uchar*>(file.data), file.size, width, height, &channels);
+		*file_format = format;
+		if (ok) *levels = textureFullLevels(*width, *height); // width and height are only set on success
+	}
+	file.deinit();
+	return ok;
+}
+
+// PBO ring for a blocking load of `bytes` of RGBA8 level 0s: room for all their mip chains at once,
+// up to 64 MB (bigger batches just wait for the GPU to drain the ring now and then)
+usize batchRingCapacity(usize bytes) {
+	return std::clamp<usize>(bytes / 3 * 4, TextureStreamer::ring_alignment, 64 << 20);
+}
+
+// Blocking: decodes on every core and returns once all textures are fully uploaded.
+// Use a TextureStreamer directly to keep rendering while they stream in.
+void loadImagesToTexture2Ds(const usize len, const char *const *const filenames, const uint *const targets, TextureFormat format = TEXTURE_RGBA8) {
+	PROFILE_SCOPE("loadImagesToTexture2Ds");
+	usize bytes = 0;
+	for (usize i = 0; i < len; i++) {
+		int width, height, levels;
+		TextureFormat file_format;
+		if (imageInfo(filenames[i], format, &width, &height, &file_format, &levels)) bytes += (usize)width * height * 4;
+	}
+	TextureStreamer streamer;
+	streamer.start(std::min<usize>(len, std::max(1u, std::thread::hardware_concurrency())), batchRingCapacity(bytes), format);
+	for (usize i = 0; i < len; i++) {
+		streamer.request(filenames[i], targets[i]);
+	}
+	streamer.finish();
+	streamer.stop();
+}
+
+// Blocking. Packs same-sized images into the layers of one GL_TEXTURE_2D_ARRAY, so objects textured
+// with any of them draw in one call and pick their layer per instance. `target` must come from
+// glCreateTextures(GL_TEXTURE_2D_ARRAY). Returns the layer of each file, -1 for files that couldn't
+// be read or don't match the first readable one in size, format and levels (only headers are read
+// to find those). .dds files keep their own format, so mixing them with other images needs `format`
+// to match theirs.
+std::vector<int> loadImagesToTexture2DArray(const usize len, const char *const *const filenames, const uint target, TextureFormat format = TEXTURE_RGBA8) {
+	PROFILE_SCOPE("loadImagesToTexture2DArray");
+	std::vector<int> layers(len, -1);
+	int layer_count = 0, width = 0, height = 0, levels = 0;
+	TextureFormat array_format = format;
+	for (usize i = 0; i < len; i++) {
+		int w, h, l;
+		TextureFormat f;
+		if (!imageInfo(filenames[i], format, &w, &h, &f, &l)) {
+			std::cout << "Failed to load texture " << filenames[i] << std::endl;
+			continue;
+		}
+		if (layer_count == 0) {
+			width = w;
+			height = h;
+			levels = l;
+			array_format = f;
+		} else if (f != array_format) {
+			std::cout << "Failed to load texture " << filenames[i] << " into the array, it's not in the same format as the first" << std::endl;
+			continue;
+		} else if (w != width || h != height || l != levels) {
+			std::cout << "Failed to load texture " << filenames[i] << " into the array, it's " << w << "x" << h << " with " << l << " levels, not "
+				<< width << "x" << height << " with " << levels << std::endl;
+			continue;
+		}
+		layers[i] = layer_count++;
+	}
+	if (layer_count == 0) return layers;
+
+	glTextureStorage3D(target, levels, textureInternalFormat(array_format), width, height, layer_count);
+	TextureStreamer streamer;
+	streamer.start(std::min<usize>(layer_count, std::max(1u, std::thread::hardware_concurrency())), batchRingCapacity((usize)width * height * 4 * layer_count), format);
+	for (usize i = 0; i < len; i++) {
+		if (layers[i] >= 0) streamer.request(filenames[i], target, layers[i]);
+	}
+	streamer.finish();
+	streamer.stop();
+	return layers;
+}
+
+// Blocking, on the GL thread. `texture` must come from glCreateTextures(GL_TEXTURE_2D).
+bool loadDDSToTexture2D(const char *const filename, uint texture) {
+	PROFILE_SCOPE("loadDDSToTexture2D");
+	FileView file = FileView::init(filename);
+	if (file.data == nullptr) {
+		std::cout << "Failed to load texture " << filename << std::endl;
+		return false;
+	}
+	DdsInfo info;
+	if (!parseLoadableDDS(file.data, file.size, &info)) {
+		std::cout << "Failed to load texture " << filename << ", not a supported DDS file" << std::endl;
+		file.deinit();
+		return false;
+	}
+
+	glTextureStorage2D(texture, info.levels, textureInternalFormat(info.format), info.width, info.height);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	const char *level_data = file.data + info.data_offset;
+	for (int level = 0; level < info.levels; level++) {
+		const int level_width = std::max(1, info.width >> level), level_height = std::max(1, info.height >> level);
+		const usize level_size = textureLevelSize(info.format, level_width, level_height);
+		if (info.format == TEXTURE_RGBA8) {
+			glTextureSubImage2D(texture, level, 0, 0, level_width, level_height, GL_RGBA, GL_UNSIGNED_BYTE, level_data);
+		} else {
+			glCompressedTextureSubImage2D(texture, level, 0, 0, level_width, level_height, textureInternalFormat(info.format), level_size, level_data);
+		}
+		level_data += level_size;
+	}
+	file.deinit(); // the driver has copied the data by the time glCompressedTextureSubImage2D returns
+	return true;
+}
+
+// Blocking, like loadImagesToTexture2Ds but for baked .dds files
+void loadDDSToTexture2Ds(const usize len, const char *const *const filenames, const uint *const targets) {
+	for (usize i = 0; i < len; i++) {
+		loadDDSToTexture2D(filenames[i], targets[i]);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <array>
+#include <atomic>
+
+// Lock-free single producer, single consumer handoff of the latest value. The producer fills
+// write() and publishes it, the consumer picks up the newest published value with update(). Neither
+// side ever waits for the other: values the consumer didn't get to are simply overwritten.
+template<typename T>
+struct TripleBuffer {
+	static constexpr uint DIRTY = 4; // set in `middle` when it holds a value the consumer hasn't seen
+
+	std::array<T, 3> slots;
+	std::atomic<uint> middle; // slot index shared between the two sides, | DIRTY
+	uint back;  // producer only
+	uint front; // consumer only
+
+	// not copyable (atomic), so initialized in place
+	void reset(const T &value) {
+		this->slots.fill(value);
+		this->back = 0;
+		this->middle.store(1, std::memory_order_relaxed);
+		this->front = 2;
+	}
+
+	// producer: the slot to fill before publish()
+	T &write() {
+		return this->slots[this->back];
+	}
+
+	void publish() {
+		this->back = this->middle.exchange(this->back | DIRTY, std::memory_order_acq_rel) & ~DIRTY;
+	}
+
+	// consumer: switches read() to the newest published value, false if nothing new was published
+	bool update() {
+		if ((this->middle.load(std::memory_order_relaxed) & DIRTY) == 0) return false;
+		this->front = this->middle.exchange(this->front, std::memory_order_acq_rel) & ~DIRTY;
+		return true;
+	}
+
+	const T &read() const {
+		return this->slots[this->front];
+	}
+};
@@ -1,9 +1,20 @@
 #pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <vector>
 
-using glm::mat4, glm::vec2, glm::vec3, glm::vec4, glm::uvec2;
+using glm::mat4, glm::vec2, glm::vec3, glm::vec4, glm::uvec2, glm::ivec2;
 namespace chrono = std::chrono;
 
 typedef unsigned char uchar;
@@ -35,9 +46,213 @@ struct Vertex {
 	vec2 uv;
 };
 
+// attribute locations in 3d.vert
+enum Attrib {
+	ATTRIB_POS = 0,
+	ATTRIB_CLR = 1,
+	ATTRIB_NORM = 2,
+	ATTRIB_UV = 3,
+};
+
+enum VertexEncoding {
+	VERTEX_FULL,  // `Vertex` as is, 48 bytes
+	VERTEX_HALF,  // half float positions, 2_10_10_10 normals
+	VERTEX_SNORM, // snorm16 positions (must lie in [-1, 1]), 2_10_10_10 normals
+};
+
+struct AttribFormat {
+	Attrib attrib;
+	int size;
+	GLenum type;
+	bool normalized;
+	uint offset;
+};
+
+// GPU-side layout of `Vertex`. Compact encodings only carry color/uv when the mesh uses them.
+struct VertexFormat {
+	VertexEncoding encoding;
+	std::vector<AttribFormat> attribs;
+	uint stride;
+
+	static VertexFormat init(VertexEncoding encoding, bool clr, bool uv) {
+		VertexFormat fmt = {};
+		fmt.encoding = encoding;
+		if (encoding == VERTEX_FULL) {
+			fmt.attribs = {
+				{ ATTRIB_POS,  3, GL_FLOAT, false, offsetof(Vertex, pos) },
+				{ ATTRIB_CLR,  4, GL_FLOAT, false, offsetof(Vertex, clr) },
+				{ ATTRIB_NORM, 3, GL_FLOAT, false, offsetof(Vertex, norm) },
+				{ ATTRIB_UV,   2, GL_FLOAT, false, offsetof(Vertex, uv) },
+			};
+			fmt.stride = sizeof(Vertex);
+			return fmt;
+		}
+		// 3 components + 2 bytes of padding keep everything after it 4-byte aligned
+		const GLenum pos_type = encoding == VERTEX_HALF ? GL_HALF_FLOAT : GL_SHORT;
+		fmt.attribs.push_back({ ATTRIB_POS,  3, pos_type, encoding == VERTEX_SNORM, 0 });
+		fmt.attribs.push_back({ ATTRIB_NORM, 4, GL_INT_2_10_10_10_REV, true, 8 });
+		fmt.stride = 12;
+		if (clr) {
+			fmt.attribs.push_back({ ATTRIB_CLR, 4, GL_UNSIGNED_BYTE, true, fmt.stride });
+			fmt.stride += 4;
+		}
+		if (uv) {
+			fmt.attribs.push_back({ ATTRIB_UV, 2, GL_HALF_FLOAT, false, fmt.stride });
+			fmt.stride += 4;
+		}
+		return fmt;
+	}
+
+	void setup(uint vao, uint vbo) const {
+		glVertexArrayVertexBuffer(vao, 0, vbo, 0, this->stride);
+		for (const AttribFormat &a : this->attribs) {
+			glEnableVertexArrayAttrib(vao, a.attrib);
+			glVertexArrayAttribFormat(vao, a.attrib, a.size, a.type, a.normalized, a.offset);
+			glVertexArrayAttribBinding(vao, a.attrib, 0);
+		}
+	}
+
+	std::vector<uchar> pack(const std::vector<Vertex> &vertices) const {
+		std::vector<uchar> data(this->stride * vertices.size());
+		this->packInto(vertices, data.data());
+		return data;
+	}
+
+	// `out` must hold stride * vertices.size() bytes
+	void packInto(const std::vector<Vertex> &vertices, uchar *const out) const {
+		if (this->encoding == VERTEX_FULL) {
+			std::memcpy(out, vertices.data(), sizeof(Vertex)*vertices.size());
+			return;
+		}
+		for (usize i = 0; i < vertices.size(); i++) {
+			uchar *const dst = out + i*this->stride;
+			const Vertex &v = vertices[i];
+			for (const AttribFormat &a : this->attribs) {
+				vec4 src;
+				switch (a.attrib) {
+				case ATTRIB_POS:  src = vec4(v.pos, 1.0f); break;
+				case ATTRIB_CLR:  src = v.clr; break;
+				case ATTRIB_NORM: src = vec4(v.norm, 0.0f); break;
+				case ATTRIB_UV:   src = vec4(v.uv, 0.0f, 0.0f); break;
+				}
+				packAttrib(dst + a.offset, a, src);
+			}
+		}
+	}
+
+	static void packAttrib(uchar *const dst, const AttribFormat &a, const vec4 src) {
+		switch (a.type) {
+		case GL_FLOAT:
+			std::memcpy(dst, &src, sizeof(float)*a.size);
+			break;
+		case GL_HALF_FLOAT:
+			for (int c = 0; c < a.size; c++) {
+				const uint16_t h = glm::packHalf1x16(src[c]);
+				std::memcpy(dst + c*sizeof(h), &h, sizeof(h));
+			}
+			break;
+		case GL_SHORT:
+			for (int c = 0; c < a.size; c++) {
+				const uint16_t n = glm::packSnorm1x16(src[c]);
+				std::memcpy(dst + c*sizeof(n), &n, sizeof(n));
+			}
+			break;
+		case GL_UNSIGNED_BYTE:
+			for (int c = 0; c < a.size; c++) dst[c] = glm::packUnorm1x8(src[c]);
+			break;
+		case GL_INT_2_10_10_10_REV: {
+			const uint32_t n = glm::packSnorm3x10_1x2(src);
+			std::memcpy(dst, &n, sizeof(n));
+			break;
+		}
+		}
+	}
+};
+
+// GL's indirect draw records
+struct DrawElementsIndirectCommand {
+	uint count;
+	uint instance_count;
+	uint first_index;
+	int base_vertex;
+	uint base_instance;
+};
+
+struct DrawArraysIndirectCommand {
+	uint count;
+	uint instance_count;
+	uint first;
+	uint base_instance;
+};
+
+struct Mesh {
+	std::vector<Vertex> vertices;
+	std::vector<uint> indices;
+	GLenum index_type;
+	usize index_count;
+	uint buffer;
+	usize vertex_offset;
+	usize index_offset;
+
+	static GLenum indexType(usize vertex_count) {
+		return vertex_count <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	}
+
+	static usize indexSize(GLenum index_type) {
+		return index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint);
+	}
+
+	// `out` must hold indexSize(index_type) * indices.size() bytes
+	void writeIndices(void *const out) const {
+		if (this->index_type == GL_UNSIGNED_SHORT) {
+			std::copy(this->indices.begin(), this->indices.end(), reinterpret_cast<uint16_t*>(out));
+		} else {
+			std::memcpy(out, this->indices.data(), sizeof(uint)*this->indices.size());
+		}
+	}
+
+	// writes into the ranges at `vertex_offset`/`index_offset` of `buffer`, which must already be
+	// sized for them, with indices narrowed to `index_type`
+	void upload(const VertexFormat &fmt) const {
+		if (fmt.encoding == VERTEX_FULL) {
+			glNamedBufferSubData(this->buffer, this->vertex_offset, sizeof(Vertex)*this->vertices.size(), this->vertices.data());
+		} else {
+			const std::vector<uchar> packed = fmt.pack(this->vertices);
+			glNamedBufferSubData(this->buffer, this->vertex_offset, packed.size(), packed.data());
+		}
+		std::vector<uchar> packed_indices(indexSize(this->index_type) * this->indices.size());
+		this->writeIndices(packed_indices.data());
+		glNamedBufferSubData(this->buffer, this->index_offset, packed_indices.size(), packed_indices.data());
+	}
+
+	// vertices and indices share one buffer, so switching meshes only rebinds ranges
+	void bind(uint vao, uint stride) const {
+		glVertexArrayVertexBuffer(vao, 0, this->buffer, this->vertex_offset, stride);
+		glVertexArrayElementBuffer(vao, this->buffer);
+	}
+
+	// draws `instances` instances of the mesh once bound
+	DrawElementsIndirectCommand command(int instances, uint first_instance) const {
+		return DrawElementsIndirectCommand{ (uint)this->index_count, (uint)instances, (uint)(this->index_offset / indexSize(this->index_type)), 0, first_instance };
+	}
+};
+
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 void GLAPIENTRY debugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
 std::string readFile(const char *const filepath);
+std::string shaderSource(const char *const filename);
+
+// context state shared by the window and headless paths, once GLAD is loaded
+void setupGLContext() {
+	// let the driver compile shaders on its own threads, see ProgramBuild
+	if (GLAD_GL_KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+
+	glEnable(GL_DEBUG_OUTPUT);
+	glDebugMessageCallback(debugMessageCallback, 0);
+	// GpuTimer pushes a debug group per pass every frame, don't echo those
+	glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+	glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+}
 
 GLFWwindow* init() {
 	glfwInit();
@@ -64,8 +279,7 @@ GLFWwindow* init() {
 	glfwGetFramebufferSize(window, &width, &height);
 	framebufferSizeCallback(window, width, height);
 
-	glEnable(GL_DEBUG_OUTPUT);
-	glDebugMessageCallback(debugMessageCallback, 0);
+	setupGLContext();
 
 	return window;
 }
@@ -129,52 +343,337 @@ void freeBuffers(usize va_len, uint* va, usize b_len, uint* b) {
 	if (b != nullptr) glDeleteBuffers(b_len, b);
 }
 
-void loadImagesToTexture2Ds(const usize len, const char *const *const filenames, const uint *const targets) {
-	stbi_set_flip_vertically_on_load(true); // opengl/glfw dum dum
-	for (usize i = 0; i < len; i++) {
-		const char *const filename = filenames[i];
-		const uint target = targets[i];
-
-		int width, height, nrChannels;
-		uchar *data = stbi_load(filename, &width, &height, &nrChannels, 4);
-		if (data) {
-			glTextureStorage2D(target, 1, GL_RGBA8, width, height);
-			glTextureSubImage2D(target, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		} else {
-			std::cout << "Failed to load texture!" << std::endl;
+// Fences for a persistently mapped ring with one slot per frame in flight, shared by UniformRing
+// and DrawList. next() moves on to the slot after the current one, waiting for the GPU to finish
+// with it first; fence() marks the current slot busy once its reads have been submitted.
+struct SlotFences {
+	static constexpr usize slots = 3;
+
+	usize slot;
+	std::array<GLsync, slots> fences;
+
+	void deinit() {
+		for (GLsync &fence : this->fences) {
+			if (fence != nullptr) glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	// the new current slot
+	usize next() {
+		this->slot = (this->slot + 1) % slots;
+		GLsync &fence = this->fences[this->slot];
+		if (fence != nullptr) {
+			// already signaled unless the GPU is a whole ring behind
+			GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			while (status == GL_TIMEOUT_EXPIRED) status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			glDeleteSync(fence);
+			fence = nullptr;
 		}
-		stbi_image_free(data);
+		return this->slot;
 	}
+
+	void fence() {
+		this->fences[this->slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+};
+
+// Persistently mapped ring of uniform slices, one per frame in flight. Each slot is fenced
+// after the frame that reads it, so writing never overwrites data the GPU may still be using
+// and never forces the driver to orphan or copy the buffer.
+struct UniformRing {
+	static constexpr usize slots = SlotFences::slots;
+
+	uint buffer;
+	uchar *data;
+	usize size;
+	usize stride;
+	SlotFences fences;
+
+	static UniformRing init(uint buffer, usize size) {
+		UniformRing ring = {};
+		int align;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+		ring.buffer = buffer;
+		ring.size = size;
+		ring.stride = (size + align - 1) / align * align;
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glNamedBufferStorage(buffer, ring.stride * slots, nullptr, flags);
+		ring.data = reinterpret_cast<uchar*>(glMapNamedBufferRange(buffer, 0, ring.stride * slots, flags));
+		return ring;
+	}
+
+	void deinit() {
+		this->fences.deinit();
+		glUnmapNamedBuffer(this->buffer);
+		this->data = nullptr;
+	}
+
+	// copies `src` into the next slot and binds that slice to `binding`
+	void push(uint binding, const void *const src) {
+		const usize slot = this->fences.next();
+		std::memcpy(this->data + slot*this->stride, src, this->size);
+		glBindBufferRange(GL_UNIFORM_BUFFER, binding, this->buffer, slot*this->stride, this->size);
+	}
+
+	// call once the commands reading the current slot have been submitted
+	void fence() {
+		this->fences.fence();
+	}
+};
+
+// Linked programs are cached on disk with glGetProgramBinary, so later launches skip the compiler.
+// Binaries are only valid for the driver that produced them, so the driver strings are part of the key.
+constexpr const char *PROGRAM_CACHE_DIR = "./shader_cache";
+
+// FNV-1a
+uint64_t hashBytes(const void *const data, usize size, uint64_t hash = 0xcbf29ce484222325ull) {
+	const uchar *const bytes = reinterpret_cast<const uchar*>(data);
+	for (usize i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+std::string programCachePath(const std::vector<const std::string*> &sources) {
+	uint64_t hash = hashBytes(nullptr, 0);
+	for (const GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+		const char *const str = reinterpret_cast<const char*>(glGetString(name));
+		hash = hashBytes(str, std::strlen(str) + 1, hash);
+	}
+	for (const std::string *const src : sources) {
+		hash = hashBytes(src->data(), src->size() + 1, hash);
+	}
+	char name[32];
+	std::snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)hash);
+	return PROGRAM_CACHE_DIR + std::string(name);
 }
 
+// 0 on a miss, or if the driver rejects the binary (e.g. after a driver update with the same strings)
+uint loadProgramBinary(const std::string &path) {
+	std::ifstream file(path, std::ios::binary);
+	GLenum format;
+	if (!file.read(reinterpret_cast<char*>(&format), sizeof(format))) return 0;
+	int format_count = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+	std::vector<int> formats(format_count);
+	if (format_count > 0) glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+	if (std::find(formats.begin(), formats.end(), (int)format) == formats.end()) return 0;
+	const std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	uint program = glCreateProgram();
+	glProgramBinary(program, format, binary.data(), binary.size());
+	int linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+// `program` must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+void storeProgramBinary(const std::string &path, uint program) {
+	int formats = 0, length = 0, linked = GL_FALSE;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (formats == 0 || !linked || length == 0) return;
+	std::vector<char> binary(length);
+	GLenum format;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	std::error_code error;
+	std::filesystem::create_directories(PROGRAM_CACHE_DIR, error);
+	// write then rename, so a concurrent launch never reads half a file
+	const std::string tmp_path = path + ".tmp";
+	{
+		std::ofstream file(tmp_path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+		file.write(binary.data(), length);
+		if (!file) return;
+	}
+	std::filesystem::rename(tmp_path, path, error);
+}
+
+// A program compiling and linking in the background. With GL_KHR_parallel_shader_compile the driver
+// does the work on its own threads and ready() never blocks; without it the first query blocks.
+struct ProgramBuild {
+	uint program;
+	std::vector<uint> shaders; // empty if the program came from the binary cache
+	std::string cache_path;
+
+	// Reads every stage with shaderSource; throws like readFile if one can't be read.
+	// `defines` (e.g. "#define BINDLESS\n") go right after each stage's #version line.
+	static ProgramBuild init(const std::vector<std::pair<GLenum, const char*>> &stages, const std::string &defines = "") {
+		PROFILE_SCOPE("ProgramBuild::init");
+		std::vector<std::string> srcs;
+		std::vector<const std::string*> src_ptrs;
+		for (const auto &[type, filename] : stages) {
+			std::string src = shaderSource(filename);
+			if (!defines.empty()) {
+				const usize line_end = src.find('\n');
+				src.insert(line_end == std::string::npos ? src.size() : line_end + 1, defines + "#line 2\n");
+			}
+			srcs.push_back(std::move(src));
+		}
+		for (const std::string &src : srcs) src_ptrs.push_back(&src);
+
+		ProgramBuild build = {};
+		build.cache_path = programCachePath(src_ptrs);
+		build.program = loadProgramBinary(build.cache_path);
+		if (build.program != 0) return build;
+
+		// no status queries until ready(), they would wait for the compiler
+		build.program = glCreateProgram();
+		for (usize i = 0; i < stages.size(); i++) {
+			const char *src_c = srcs[i].data();
+			uint shader = glCreateShader(stages[i].first);
+			glShaderSource(shader, 1, &src_c, NULL);
+			glCompileShader(shader);
+			glAttachShader(build.program, shader);
+			build.shaders.push_back(shader);
+		}
+		glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(build.program);
+		return build;
+	}
+
+	bool ready() const {
+		if (this->shaders.empty() || !GLAD_GL_KHR_parallel_shader_compile) return true;
+		int done = GL_FALSE;
+		glGetProgramiv(this->program, GL_COMPLETION_STATUS_KHR, &done);
+		return done == GL_TRUE;
+	}
+
+	// waits if not ready(). Returns the linked program, or 0 after printing the logs if it failed.
+	uint finish() {
+		if (this->shaders.empty()) return this->program;
+		int linked = GL_FALSE;
+		glGetProgramiv(this->program, GL_LINK_STATUS, &linked);
+		if (!linked) {
+			char log[4096];
+			for (const uint shader : this->shaders) {
+				int compiled = GL_FALSE;
+				glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+				if (compiled) continue;
+				glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+				std::cout << "Failed to compile shader:\n" << log << std::endl;
+			}
+			glGetProgramInfoLog(this->program, sizeof(log), nullptr, log);
+			std::cout << "Failed to link program:\n" << log << std::endl;
+		}
+		for (const uint shader : this->shaders) {
+			glDetachShader(this->program, shader);
+			glDeleteShader(shader);
+		}
+		this->shaders.clear();
+		if (!linked) {
+			glDeleteProgram(this->program);
+			this->program = 0;
+			return 0;
+		}
+		storeProgramBinary(this->cache_path, this->program);
+		return this->program;
+	}
+};
+
 uint createShader(const char *const vert_filename, const char *const frag_filename) {
-	const std::string vert_src = readFile(vert_filename), frag_src = readFile(frag_filename);
-	const char *vert_src_c = vert_src.data(), *frag_src_c = frag_src.data();
+	PROFILE_SCOPE("createShader");
+	return ProgramBuild::init({ { GL_VERTEX_SHADER, vert_filename }, { GL_FRAGMENT_SHADER, frag_filename } }).finish();
+}
 
-	uint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex_shader, 1, &vert_src_c, NULL);
-	glCompileShader(vertex_shader);
+uint createComputeShader(const char *const comp_filename) {
+	PROFILE_SCOPE("createComputeShader");
+	return ProgramBuild::init({ { GL_COMPUTE_SHADER, comp_filename } }).finish();
+}
 
-	uint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment_shader, 1, &frag_src_c, NULL);
-	glCompileShader(fragment_shader);
+struct EmbeddedShader {
+	const char *name; // file name without directory
+	std::string_view src;
+};
 
-	uint shader = glCreateProgram();
-	glAttachShader(shader, vertex_shader);
-	glAttachShader(shader, fragment_shader);
-	glLinkProgram(shader);
+#ifdef EMBED_SHADERS
+#include "embedded_shaders.hpp"
+#endif
 
-	glDeleteShader(vertex_shader);
-	glDeleteShader(fragment_shader);
-	return shader;
+// the shader file's source, compiled into the binary when built with EMBED_SHADERS (see build.sh)
+std::string shaderSource(const char *const filename) {
+#ifdef EMBED_SHADERS
+	const std::string name = std::filesystem::path(filename).filename().string();
+	for (const EmbeddedShader &shader : EMBEDDED_SHADERS) {
+		if (name == shader.name) return std::string(shader.src);
+	}
+	std::cout << "Failed to find embedded shader " << filename << std::endl;
+	exit(-1);
+#else
+	return readFile(filename);
+#endif
 }
 
+// Read-only view of a whole file, mapped straight from the page cache without copying.
+// `data` stays valid until deinit(); copies share the mapping, so deinit exactly one of them.
+// Reading it raises SIGBUS if the file is truncated meanwhile, so files that get edited in place
+// (shaders) go through readFile instead.
+struct FileView {
+	const char *data; // nullptr if the file couldn't be opened or mapped
+	usize size;
+
+	static FileView init(const char *const filepath) {
+		FileView view = {};
+		const int fd = open(filepath, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) return view;
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			close(fd);
+			return view;
+		}
+		if (st.st_size == 0) {
+			view.data = ""; // mmap can't map 0 bytes
+		} else {
+			void *const ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (ptr != MAP_FAILED) {
+				madvise(ptr, st.st_size, MADV_SEQUENTIAL); // read-ahead, loads read front to back
+				view.data = reinterpret_cast<const char*>(ptr);
+				view.size = st.st_size;
+			}
+		}
+		close(fd); // the mapping keeps the file alive
+		return view;
+	}
+
+	void deinit() {
+		if (this->size > 0) munmap(const_cast<char*>(this->data), this->size);
+		*this = {};
+	}
+
+	std::string_view view() const {
+		return std::string_view(this->data, this->size);
+	}
+};
+
+// Copies with read() rather than mapping a FileView: shaders are reread on hot reload, just when an
+// editor may be truncating them. Throws std::ios_base::failure if the file can't be read.
 std::string readFile(const char *const filepath) {
-	std::ifstream file;
-	file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	file.open(filepath);
-	std::stringstream stream;
-	stream << file.rdbuf();
-	file.close();
-	return stream.str();
+	const int fd = open(filepath, O_RDONLY | O_CLOEXEC);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		if (fd >= 0) close(fd);
+		throw std::ios_base::failure(std::string("Failed to read ") + filepath);
+	}
+	// sized once up front, one spare byte so reading up to EOF doesn't grow it; the file may still
+	// shrink (editor saving in place) or grow while we read
+	std::string contents(st.st_size + 1, '\0');
+	usize filled = 0;
+	ssize_t len = 1;
+	while (len > 0) {
+		if (filled == contents.size()) contents.resize(contents.size() + (1 << 16));
+		len = read(fd, contents.data() + filled, contents.size() - filled);
+		if (len > 0) filled += len;
+	}
+	close(fd);
+	if (len < 0) throw std::ios_base::failure(std::string("Failed to read ") + filepath);
+	contents.resize(filled);
+	return contents;
 }